@@ -1,22 +1,64 @@
 import time
+import json
+import random
+import zlib
+import microcontroller
 import wifi
 import socketpool
 import ssl
 import adafruit_requests as requests
 from secrets import secrets
-from config import PLANT_INFO, AI_REQUEST_INTERVAL, WIFI_TIMEOUT, MAX_WIFI_RETRIES
+from config import (
+    PLANT_INFO,
+    AI_REQUEST_INTERVAL,
+    AI_ASYNC_JOBS,
+    AI_DEFLATE_WBITS,
+    AI_RETRY_KEY_MAX_AGE,
+    WIFI_TIMEOUT,
+    MAX_WIFI_RETRIES
+)
+from utils.logger import log
+
+# Characters a URL path segment may hold unescaped (RFC 3986 unreserved)
+_UNRESERVED = b"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-._~"
+
+def quote(text):
+    """Percent-encode text for a URL path segment (CircuitPython has no urllib)"""
+    return "".join(chr(byte) if byte in _UNRESERVED else "%%%02X" % byte for byte in text.encode("utf-8"))
 
 class AIPlantMelodyGenerator:
     """Generates AI-powered melodies based on comprehensive plant status"""
     
-    def __init__(self):
-        """Initialize the AI melody generator"""
+    def __init__(self, energy=None):
+        """Initialize the AI melody generator
+        
+        Args:
+            energy (EnergyManager): Charged for radio on-time, if given
+        """
+        self.energy = energy
         self.pool = None
         self.https = None
         self.is_wifi_connected = False
         self.last_ai_request_time = 0
         self.last_generated_melody = None
         self.last_status_message = ""
+        self.last_wifi_connect_ms = 0
+        
+        # Lengthened by the energy manager when the battery budget is tight
+        self.ai_request_interval = AI_REQUEST_INTERVAL
+        
+        # Set by the energy manager to switch WiFi off between requests
+        self.radio_off = False
+        
+        # Stable id so the server can keep this device's reading history
+        self.device_id = "".join("%02x" % b for b in microcontroller.cpu.uid)
+        
+        # Pending asynchronous job, collected on a later cycle
+        self.pending_ticket = None
+        self.next_poll_time = 0
+        
+        # (idempotency key, payload, first sent) of a POST that got no response
+        self.unanswered_request = None
         
         # Enhanced prompt template for plant-specific melodies
         self.prompt_template = """
@@ -44,25 +86,58 @@ MELODY: [note,duration,note,duration,...]
         if self.is_wifi_connected:
             return True
             
-        print("Connecting to WiFi...")
+        log.info("Connecting to WiFi...")
+        connect_start = time.monotonic()
+        if self.energy:
+            self.energy.start('radio')
         
         for attempt in range(MAX_WIFI_RETRIES):
             try:
+                wifi.radio.enabled = True
                 wifi.radio.connect(secrets["ssid"], secrets["password"])
                 self.pool = socketpool.SocketPool(wifi.radio)
                 self.https = requests.Session(self.pool, ssl.create_default_context())
                 self.is_wifi_connected = True
-                print(f"WiFi connected! IP: {wifi.radio.ipv4_address}")
+                self.last_wifi_connect_ms = int((time.monotonic() - connect_start) * 1000)
+                log.info("WiFi connected! IP: %s", wifi.radio.ipv4_address)
+                if self.energy:
+                    self.energy.stop('radio')
+                    # An associated radio keeps drawing current between requests
+                    self.energy.start('radio_idle')
                 return True
                 
             except Exception as e:
-                print(f"WiFi connection attempt {attempt + 1} failed: {e}")
+                log.warning("WiFi connection attempt %d failed: %s", attempt + 1, e)
                 if attempt < MAX_WIFI_RETRIES - 1:
                     time.sleep(2)
         
-        print("Failed to connect to WiFi after all attempts")
+        log.error("Failed to connect to WiFi after all attempts")
+        if self.energy:
+            self.energy.stop('radio')
         return False
     
+    def disconnect_wifi(self):
+        """Switch the WiFi radio off; the next request reconnects"""
+        if not self.is_wifi_connected:
+            return
+        wifi.radio.enabled = False
+        self.pool = None
+        self.https = None
+        self.is_wifi_connected = False
+        if self.energy:
+            self.energy.stop('radio_idle')
+        log.debug("WiFi off until the next request")
+    
+    def idle_radio(self):
+        """Switch WiFi off between requests if the power level asks for it
+        
+        A pending job is collected after reconnecting on a later cycle; at
+        the saving levels' loop delays, a reconnect costs less charge than
+        staying associated until then.
+        """
+        if self.radio_off:
+            self.disconnect_wifi()
+    
     def generate_plant_mood(self, comprehensive_status):
         """Generate a mood description based on plant status
         
@@ -97,7 +172,7 @@ MELODY: [note,duration,note,duration,...]
     def should_request_new_melody(self):
         """Check if enough time has passed to request a new melody"""
         current_time = time.monotonic()
-        return (current_time - self.last_ai_request_time) >= AI_REQUEST_INTERVAL
+        return (current_time - self.last_ai_request_time) >= self.ai_request_interval
     
     def generate_melody_and_message(self, comprehensive_status):
         """Generate AI melody and message based on plant status
@@ -111,6 +186,14 @@ MELODY: [note,duration,note,duration,...]
         if not self.should_request_new_melody():
             return self.last_generated_melody, self.last_status_message
         
+        # A pending job that is not due for polling needs no radio
+        if AI_ASYNC_JOBS and self.pending_ticket and time.monotonic() < self.next_poll_time:
+            return self.last_generated_melody, self.last_status_message
+        
+        # Trace id lets the server's trace be matched with this cycle's logs
+        trace_id = "%08x%08x" % (random.getrandbits(32), random.getrandbits(32))
+        self.last_wifi_connect_ms = 0
+        
         if not self.connect_wifi():
             return None, "WiFi Error"
         
@@ -137,17 +220,34 @@ MELODY: [note,duration,note,duration,...]
                 "plant_type": PLANT_INFO['type'],
                 "soil_moisture": comprehensive_status['soil_value'],
                 "temperature": comprehensive_status['ambient_temperature'],
-                "humidity": comprehensive_status['ambient_humidity']
+                "humidity": comprehensive_status['ambient_humidity'],
+                "device_id": self.device_id
             }
             
             url = secrets["url_mcp"] + "/consulta"
-            print("Requesting AI melody from:", url)
+            log.info("Requesting AI melody from: %s trace: %s", url, trace_id)
+            
+            headers = {
+                "X-Trace-Id": trace_id,
+                "X-Device-Wifi-Ms": str(self.last_wifi_connect_ms)
+            }
+            if AI_DEFLATE_WBITS:
+                headers["Accept-Encoding"] = "deflate"
             
             # Make API request
-            response = self.https.post(url, json=payload)
+            if AI_ASYNC_JOBS:
+                response = self.submit_or_collect_job(payload, headers)
+                if response is None:
+                    # Job still running: keep the last melody until the result is ready
+                    return self.last_generated_melody, self.last_status_message
+            else:
+                key, payload = self.retry_key(payload)
+                headers["Idempotency-Key"] = key
+                response = self.request("POST", url, json=payload, headers=headers)
+                self.unanswered_request = None
             
             if response.status_code == 200:
-                ai_response = response.json().get("respuesta", "")
+                ai_response = self.read_json(response).get("respuesta", "")
                 melody, message = self.parse_ai_response(ai_response)
                 
                 # Update cache
@@ -155,18 +255,159 @@ MELODY: [note,duration,note,duration,...]
                 self.last_generated_melody = melody
                 self.last_status_message = message
                 
-                print(f"AI Response: {message}")
-                print(f"Generated melody: {melody}")
+                log.info("AI Response: %s", message)
+                log.debug("Generated melody: %s", melody)
                 
                 return melody, message
+            elif response.status_code == 503:
+                # Server is shedding load: hold off until its Retry-After has passed
+                retry_after = self.get_retry_after(response)
+                self.last_ai_request_time = time.monotonic() - self.ai_request_interval + retry_after
+                log.warning("AI server busy, retrying in %ss (trace %s)", retry_after, trace_id)
+                return None, "AI Busy"
             else:
-                print(f"API Error: {response.status_code}")
+                log.error("API Error: %s (trace %s)", response.status_code, trace_id)
                 return None, "AI Error"
                 
         except Exception as e:
-            print(f"Error generating AI melody: {e}")
+            log.error("Error generating AI melody: %s (trace %s)", e, trace_id)
             return None, "Request Failed"
     
+    def submit_or_collect_job(self, payload, headers):
+        """Submit a generation job, or collect the result of the pending one
+        
+        The device does not hold a connection open while the server generates;
+        it picks up the result on a later cycle.
+        
+        Args:
+            payload (dict): /consulta request body
+            headers (dict): Request headers
+            
+        Returns:
+            Response with the finished result, or None while the job is pending
+        """
+        jobs_url = secrets["url_mcp"] + "/consulta/jobs"
+        
+        if self.pending_ticket:
+            if time.monotonic() < self.next_poll_time:
+                return None
+            response = self.request("GET", jobs_url + "/" + self.pending_ticket, headers=headers)
+            if response.status_code == 202:
+                self.next_poll_time = time.monotonic() + self.get_retry_after(response)
+                return None
+            self.pending_ticket = None
+            if response.status_code != 404:
+                return response
+            log.info("AI job expired, submitting a new one")
+        
+        key, payload = self.retry_key(payload)
+        headers["Idempotency-Key"] = key
+        response = self.request("POST", jobs_url, json=payload, headers=headers)
+        self.unanswered_request = None
+        if response.status_code != 202:
+            return response
+        
+        job = self.read_json(response)
+        self.pending_ticket = job["ticket"]
+        self.next_poll_time = time.monotonic() + job.get("retry_after", 10)
+        log.info("AI job submitted: %s", self.pending_ticket)
+        return None
+    
+    def retry_key(self, payload):
+        """Idempotency key and payload for a POST
+        
+        A POST that raised (timeout, dropped link) may still have reached the
+        server, so its retry resends the same key and readings; the server
+        then hands back the original result instead of generating another.
+        A fresh key is used once any response arrives or the readings are
+        older than AI_RETRY_KEY_MAX_AGE.
+        
+        Args:
+            payload (dict): Request body built from this cycle's readings
+            
+        Returns:
+            tuple: (key, payload to send)
+        """
+        now = time.monotonic()
+        if self.unanswered_request and now - self.unanswered_request[2] < AI_RETRY_KEY_MAX_AGE:
+            return self.unanswered_request[0], self.unanswered_request[1]
+        key = "%08x%08x" % (random.getrandbits(32), random.getrandbits(32))
+        self.unanswered_request = (key, payload, now)
+        return key, payload
+    
+    def fetch_profile(self, species, etag=None):
+        """Fetch the species threshold profile, revalidating a cached copy
+        
+        Args:
+            species (str): Species name, e.g. PLANT_INFO['type']
+            etag (str): ETag of the cached profile, if any
+            
+        Returns:
+            tuple: (status_code, profile or None, etag or None); 304 means the cached copy is current
+        """
+        if not self.connect_wifi():
+            return None, None, None
+        
+        headers = {"If-None-Match": etag} if etag else {}
+        response = self.request("GET", secrets["url_mcp"] + "/profiles/" + quote(species), headers=headers)
+        if response.status_code == 200:
+            return 200, self.read_json(response), response.headers.get("etag")
+        if response.status_code == 304:
+            return 304, None, etag
+        return response.status_code, None, None
+    
+    def request(self, method, url, **kwargs):
+        """Make an HTTP request, charging the radio for the time it takes
+        
+        Args:
+            method (str): HTTP method
+            url (str): Request URL
+            **kwargs: Passed to the session (json, headers)
+            
+        Returns:
+            HTTP response
+        """
+        if self.energy:
+            self.energy.stop('radio_idle')
+            self.energy.start('radio')
+        try:
+            return self.https.request(method, url, **kwargs)
+        finally:
+            if self.energy:
+                self.energy.stop('radio')
+                self.energy.start('radio_idle')
+    
+    def read_json(self, response):
+        """Parse a JSON response body, inflating it if the server deflated it
+        
+        The server compresses with a window no larger than AI_DEFLATE_WBITS,
+        so inflating never needs more than 2**AI_DEFLATE_WBITS bytes of window.
+        
+        Args:
+            response: HTTP response
+            
+        Returns:
+            dict: Parsed body
+        """
+        body = response.content
+        if response.headers.get("content-encoding") == "deflate":
+            body = zlib.decompress(body, AI_DEFLATE_WBITS)
+        return json.loads(body)
+    
+    def get_retry_after(self, response):
+        """Read the Retry-After header of a shed request or pending job
+        
+        Args:
+            response: HTTP response with status 503 or 202
+            
+        Returns:
+            int: Seconds to wait before the next request
+        """
+        try:
+            return int(response.headers.get("retry-after", AI_REQUEST_INTERVAL))
+        except (ValueError, AttributeError):
+            return AI_REQUEST_INTERVAL
+    
     def parse_ai_response(self, ai_response):
         """Parse AI response to extract message and melody
         
@@ -208,7 +449,7 @@ MELODY: [note,duration,note,duration,...]
             return melody, message
             
         except Exception as e:
-            print(f"Error parsing AI response: {e}")
+            log.warning("Error parsing AI response: %s", e)
             return "C4,0.5,E4,0.5,G4,0.5", "Parse Error"
     
     def get_cached_melody(self):
@@ -6,18 +6,23 @@ from config import (
     ALERT_FREQUENCIES, 
     BUZZER_NOTE_DURATION, 
     BUZZER_NOTE_PAUSE,
-    BUZZER_DUTY_CYCLE
+    BUZZER_DUTY_CYCLE,
+    AI_NOTE_GAP,
+    MUSICAL_NOTES
 )
+from utils.logger import log
 
 class BuzzerAlerts:
     """Manages buzzer alerts for different soil moisture conditions"""
     
-    def __init__(self, pin_name=BUZZER_PIN):
+    def __init__(self, pin_name=BUZZER_PIN, energy=None):
         """Initialize the buzzer
         
         Args:
             pin_name (str): Board pin name for the buzzer
+            energy (EnergyManager): Charged for tone on-time, if given
         """
+        self.energy = energy
         self.buzzer = pwmio.PWMOut(
             getattr(board, pin_name), 
             duty_cycle=0, 
@@ -37,9 +42,9 @@ class BuzzerAlerts:
             return
             
         self.buzzer.frequency = frequency
-        self.buzzer.duty_cycle = BUZZER_DUTY_CYCLE
+        self.tone_on()
         time.sleep(duration)
-        self.buzzer.duty_cycle = 0
+        self.tone_off()
     
     def play_melody(self, frequencies, note_duration=BUZZER_NOTE_DURATION, pause_duration=BUZZER_NOTE_PAUSE):
         """Play a sequence of notes
@@ -56,6 +61,18 @@ class BuzzerAlerts:
             self.play_note(frequency, note_duration)
             time.sleep(pause_duration)
     
+    def tone_on(self):
+        """Start the tone at the current frequency"""
+        self.buzzer.duty_cycle = BUZZER_DUTY_CYCLE
+        if self.energy:
+            self.energy.start('buzzer')
+    
+    def tone_off(self):
+        """Silence the buzzer"""
+        self.buzzer.duty_cycle = 0
+        if self.energy:
+            self.energy.stop('buzzer')
+    
     def play_status_alert(self, status):
         """Play alert melody based on soil moisture status
         
@@ -143,7 +160,7 @@ class BuzzerAlerts:
     
     def cleanup(self):
         """Clean up buzzer resources"""
-        self.buzzer.duty_cycle = 0
+        self.tone_off()
         # Note: PWMOut doesn't have a direct cleanup method in CircuitPython
     
     def play_ai_melody(self, melody_string):
@@ -155,28 +172,15 @@ class BuzzerAlerts:
         if not self.is_enabled or not melody_string:
             return
         
-        # Musical note frequencies for AI-generated melodies  
-        MUSICAL_NOTES = {
-            "C3": 131, "C#3": 139, "D3": 147, "D#3": 156, "E3": 165, "F3": 175, "F#3": 185,
-            "G3": 196, "G#3": 208, "A3": 220, "A#3": 233, "B3": 247,
-            "C4": 262, "C#4": 277, "D4": 294, "D#4": 311, "E4": 330, "F4": 349, "F#4": 370,
-            "G4": 392, "G#4": 415, "A4": 440, "A#4": 466, "B4": 494,
-            "C5": 523, "C#5": 554, "D5": 587, "D#5": 622, "E5": 659, "F5": 698, "F#5": 740,
-            "G5": 784, "G#5": 831, "A5": 880, "A#5": 932, "B5": 988,
-            "C6": 1047, "C#6": 1109, "D6": 1175, "D#6": 1245, "E6": 1319, "F6": 1397, "F#6": 1480,
-            "G6": 1568, "G#6": 1661, "A6": 1760, "A#6": 1865, "B6": 1976,
-            "C7": 2093, "R": 0  # R = Rest/silence
-        }
-        
         try:
             parts = melody_string.strip().split(",")
             
             # Ensure we have pairs of note,duration
             if len(parts) % 2 != 0:
-                print("Invalid melody format: odd number of parts")
+                log.warning("Invalid melody format: odd number of parts")
                 return
             
-            print(f"Playing AI melody: {melody_string}")
+            log.debug("Playing AI melody: %s", melody_string)
             
             for i in range(0, len(parts), 2):
                 if i + 1 >= len(parts):
@@ -192,16 +196,16 @@ class BuzzerAlerts:
                 frequency = MUSICAL_NOTES.get(note, 0)
                 
                 if frequency == 0:  # Rest or invalid note
-                    self.buzzer.duty_cycle = 0
+                    self.tone_off()
                 else:
                     self.buzzer.frequency = frequency
-                    self.buzzer.duty_cycle = BUZZER_DUTY_CYCLE
+                    self.tone_on()
                 
                 time.sleep(duration)
-                self.buzzer.duty_cycle = 0
-                time.sleep(0.05)  # Brief pause between notes
+                self.tone_off()
+                time.sleep(AI_NOTE_GAP)  # Brief pause between notes
                 
         except Exception as e:
-            print(f"Error playing AI melody: {e}")
+            log.error("Error playing AI melody: %s", e)
             # Play a simple fallback melody
             self.play_melody([440, 523, 659])
@@ -1,42 +1,60 @@
 import time
+import json
 from sensors.humidity_sensor import SoilHumiditySensor
 from sensors.dht_ambient_sensor import DHT11AmbientSensor
 from display.lcd_display import LCDDisplay
 from alerts.buzzer_alerts import BuzzerAlerts
 from utils.soil_analyzer import PlantAnalyzer
+from utils.energy_manager import EnergyManager
+from utils.melody_pack import MelodyPack
+from utils.logger import log
 from ai.melody_generator import AIPlantMelodyGenerator
-from config import MAIN_LOOP_DELAY, ENABLE_AI_MELODIES
+from config import MAIN_LOOP_DELAY, ENABLE_AI_MELODIES, PLANT_INFO, PLANT_PROFILE_PATH, PROFILE_REFRESH_INTERVAL
 
 class PlantMonitor:
     """Main plant monitoring system coordinator"""
     
     def __init__(self):
         """Initialize all system components"""
+        self.energy = EnergyManager()
         self.soil_sensor = SoilHumiditySensor()
         self.ambient_sensor = DHT11AmbientSensor()
-        self.display = LCDDisplay()
-        self.buzzer = BuzzerAlerts()
+        self.display = LCDDisplay(energy=self.energy)
+        self.buzzer = BuzzerAlerts(energy=self.energy)
         self.plant_analyzer = PlantAnalyzer()
+        self.melody_pack = MelodyPack()
         
         # AI melody generator
         self.ai_melody_generator = None
         if ENABLE_AI_MELODIES:
             try:
-                self.ai_melody_generator = AIPlantMelodyGenerator()
-                print("AI melody generation enabled")
+                self.ai_melody_generator = AIPlantMelodyGenerator(energy=self.energy)
+                log.info("AI melody generation enabled")
             except Exception as e:
-                print(f"Failed to initialize AI melody generator: {e}")
-                print("Continuing without AI features")
+                log.error("Failed to initialize AI melody generator: %s", e)
+                log.warning("Continuing without AI features")
         
         # System state
         self.is_running = False
         self.error_count = 0
         self.max_errors = 5
         self.use_ai_melodies = True  # Toggle for AI vs standard melodies
+        
+        # Power policy, adapted by the energy manager to the battery budget
+        self.loop_delay = MAIN_LOOP_DELAY
+        self.backlight_timeout = None
+        self.alert_mode = 'full'
+        self.last_alert_status = None
+        self.last_status_change = time.monotonic()
+        
+        # Species threshold profile (config.py thresholds until one is loaded)
+        self.profile = None
+        self.profile_etag = None
+        self.last_profile_check = 0
     
     def startup_sequence(self):
         """Run startup sequence"""
-        print("Plant Monitor starting...")
+        log.info("Plant Monitor starting...")
         
         # Show startup message on display
         self.display.display_startup_message()
@@ -48,28 +66,92 @@ class PlantMonitor:
         time.sleep(2)
         
         # Check if sensors are connected
-        print("Checking soil sensor connection...")
+        log.info("Checking soil sensor connection...")
         
         if not self.soil_sensor.is_sensor_connected():
             self.display.display_error("Soil Sensor Err")
             self.buzzer.play_error_sound()
-            print("Warning: Soil humidity sensor may not be connected properly")
+            log.warning("Soil humidity sensor may not be connected properly")
             time.sleep(2)
         else:
-            print("Soil sensor connected successfully")
+            log.info("Soil sensor connected successfully")
         
         if not self.ambient_sensor.is_sensor_connected():
             self.display.display_error("Ambient Sens Err")
             self.buzzer.play_error_sound()
-            print("Warning: Ambient sensor may not be connected properly")
+            log.warning("Ambient sensor may not be connected properly")
             time.sleep(2)
         else:
-            print("Ambient sensor connected successfully")
+            log.info("Ambient sensor connected successfully")
+        
+        self.load_plant_profile()
+        
+        log.info("Startup complete!")
+    
+    def load_plant_profile(self):
+        """Apply the species threshold profile
+        
+        The flash copy is applied first so the thresholds are right even
+        offline; the server is then asked with its ETag, which costs only a
+        bodiless 304 when nothing changed.
+        """
+        self.last_profile_check = time.monotonic()
+        if self.profile is None:
+            self.read_stored_profile()
+        
+        if not self.ai_melody_generator:
+            return
+        
+        try:
+            status, profile, etag = self.ai_melody_generator.fetch_profile(PLANT_INFO['type'], self.profile_etag)
+        except Exception as e:
+            log.warning("Profile fetch failed: %s", e)
+            return
         
-        print("Startup complete!")
+        if status == 304:
+            log.debug("Plant profile unchanged")
+        elif status == 200 and self.plant_analyzer.apply_profile(profile):
+            self.profile = profile
+            self.profile_etag = etag
+            log.info("Plant profile applied: %s", profile.get('name', PLANT_INFO['type']))
+            self.store_profile()
+        else:
+            log.warning("Plant profile unavailable (%s), keeping current thresholds", status)
+    
+    def read_stored_profile(self):
+        """Apply the profile saved on flash by a previous boot, if any"""
+        if not PLANT_PROFILE_PATH:
+            return
+        try:
+            with open(PLANT_PROFILE_PATH) as f:
+                stored = json.load(f)
+        except (OSError, ValueError):
+            return
+        if not isinstance(stored, dict):
+            log.warning("Stored plant profile is corrupt, ignoring it")
+            return
+        if self.plant_analyzer.apply_profile(stored.get('profile')):
+            self.profile = stored['profile']
+            self.profile_etag = stored.get('etag')
+            log.info("Plant profile loaded from flash")
+    
+    def store_profile(self):
+        """Save the profile and its ETag for the next boot"""
+        if not PLANT_PROFILE_PATH:
+            return
+        try:
+            with open(PLANT_PROFILE_PATH, "w") as f:
+                json.dump({'etag': self.profile_etag, 'profile': self.profile}, f)
+        except OSError as e:
+            # CIRCUITPY is read-only to code unless boot.py remounts it
+            log.warning("Could not save plant profile: %s", e)
     
     def read_and_display_status(self):
         """Read sensors, analyze, and update display and alerts"""
+        self.energy.start('cpu')
+        if time.monotonic() - self.last_profile_check >= PROFILE_REFRESH_INTERVAL:
+            self.load_plant_profile()
+        
         try:
             # Read soil moisture sensor
             soil_value = self.soil_sensor.read_raw_value()
@@ -79,7 +161,7 @@ class PlantMonitor:
             
             # Handle DHT11 read failures gracefully
             if ambient_humidity is None or ambient_temperature is None:
-                print("DHT11 read failed, using last known values or defaults")
+                log.warning("DHT11 read failed, using last known values or defaults")
                 # Try to get last known values
                 ambient_humidity, ambient_temperature = self.ambient_sensor.get_last_readings()
                 
@@ -100,13 +182,13 @@ class PlantMonitor:
             
             if self.ai_melody_generator and self.use_ai_melodies:
                 try:
-                    print("Requesting AI melody generation...")
+                    log.debug("Requesting AI melody generation...")
                     ai_melody, ai_message = self.ai_melody_generator.generate_melody_and_message(comprehensive_status)
                     if ai_melody:
-                        print(f"AI generated: {ai_message}")
-                        print(f"Melody: {ai_melody[:50]}...")
+                        log.info("AI generated: %s", ai_message)
+                        log.debug("Melody: %.50s...", ai_melody)
                 except Exception as e:
-                    print(f"AI melody generation failed: {e}")
+                    log.error("AI melody generation failed: %s", e)
                     ai_melody = None
                     ai_message = None
             
@@ -119,71 +201,106 @@ class PlantMonitor:
                 # Show standard comprehensive status
                 self.display.display_comprehensive_status(comprehensive_status)
             
-            # Play appropriate melody/alert
-            if ai_melody and self.use_ai_melodies:
-                # Play AI-generated melody
-                print("Playing AI-generated melody...")
-                self.buzzer.play_ai_melody(ai_melody)
-            else:
-                # Play standard alert pattern
-                self.buzzer.play_comprehensive_alert(comprehensive_status)
+            # Play appropriate melody/alert, as often as the power level allows
+            if self.should_alert(comprehensive_status['overall_status']):
+                if ai_melody and self.use_ai_melodies:
+                    # Play AI-generated melody
+                    log.debug("Playing AI-generated melody...")
+                    self.buzzer.play_ai_melody(ai_melody)
+                else:
+                    # Offline: a factory melody for the status, else the standard alert pattern
+                    pack_melody = self.melody_pack.melody(comprehensive_status['overall_status']) if self.use_ai_melodies else None
+                    if pack_melody:
+                        log.debug("Playing melody pack melody...")
+                        self.buzzer.play_ai_melody(pack_melody)
+                    else:
+                        self.buzzer.play_comprehensive_alert(comprehensive_status)
             
-            # Print detailed status to console for debugging
-            print(f"Soil: {comprehensive_status['soil_status']} ({soil_value})")
-            print(f"Ambient: {ambient_temperature:.1f}°C, {ambient_humidity:.0f}%RH")
-            print(f"Overall: {comprehensive_status['overall_status']}")
-            print(f"Action: {comprehensive_status['priority_action']}")
-            print("---")
+            # Detailed status for the console, formatted when the log is flushed
+            log.info("Soil: %s (%d) | Ambient: %.1f°C, %.0f%%RH | Overall: %s | Action: %s",
+                     comprehensive_status['soil_status'], soil_value, ambient_temperature, ambient_humidity,
+                     comprehensive_status['overall_status'], comprehensive_status['priority_action'])
             
             # Reset error count on successful reading
             self.error_count = 0
             
         except Exception as e:
             self.error_count += 1
-            error_msg = f"Error {self.error_count}: {str(e)}"
-            print(error_msg)
-            
-            # Display error on LCD
-            self.display.display_error(f"Err {self.error_count}")
-            self.buzzer.play_error_sound()
-            
-            # Stop system if too many errors
-            if self.error_count >= self.max_errors:
-                print(f"Too many errors ({self.max_errors}). Stopping system.")
-                self.stop()            # Reset error count on successful reading
-            self.error_count = 0
-            
-        except Exception as e:
-            self.error_count += 1
-            error_msg = f"Error {self.error_count}: {str(e)}"
-            print(error_msg)
+            log.error("Error %d: %s", self.error_count, e)
             
             # Display error on LCD
             self.display.display_error(f"Err {self.error_count}")
             self.buzzer.play_error_sound()
+            self.last_alert_status = 'error'
+            self.last_status_change = time.monotonic()
+            log.persist()
             
             # Stop system if too many errors
             if self.error_count >= self.max_errors:
-                print(f"Too many errors ({self.max_errors}). Stopping system.")
+                log.error("Too many errors (%d). Stopping system.", self.max_errors)
                 self.stop()
+        
+        self.apply_energy_policy()
+    
+    def should_alert(self, overall_status):
+        """Decide whether this cycle plays a melody, per the alert verbosity
+        
+        Args:
+            overall_status (str): comprehensive_status['overall_status']
+            
+        Returns:
+            bool: True to play the AI melody or standard alert
+        """
+        changed = overall_status != self.last_alert_status
+        if changed:
+            self.last_alert_status = overall_status
+            self.last_status_change = time.monotonic()
+        
+        if self.alert_mode == 'full':
+            return True
+        if self.alert_mode == 'changes':
+            return changed
+        return changed and overall_status != 'good'
+    
+    def apply_energy_policy(self):
+        """End the awake period, adopt a new power level if one was chosen, idle the radio and time out the backlight"""
+        self.energy.stop('cpu')
+        if self.energy.update():
+            policy = self.energy.policy()
+            self.loop_delay = policy['loop_delay']
+            self.backlight_timeout = policy['backlight_timeout']
+            self.alert_mode = policy['alerts']
+            if self.ai_melody_generator:
+                self.ai_melody_generator.ai_request_interval = policy['ai_interval']
+                self.ai_melody_generator.radio_off = policy['radio_off']
+        
+        if self.ai_melody_generator:
+            self.ai_melody_generator.idle_radio()
+        
+        # The backlight comes on with every status change and stays on for the timeout
+        lit = (self.backlight_timeout is None or
+               time.monotonic() - self.last_status_change < self.backlight_timeout)
+        self.display.set_backlight(lit)
     
     def run(self):
         """Run the main monitoring loop"""
         self.startup_sequence()
         self.is_running = True
         
-        print("Starting monitoring loop...")
+        log.info("Starting monitoring loop...")
         
         try:
             while self.is_running:
                 self.read_and_display_status()
-                time.sleep(MAIN_LOOP_DELAY)
+                # Console output happens here, off the sensing path
+                log.flush()
+                time.sleep(self.loop_delay)
                 
         except KeyboardInterrupt:
-            print("\nShutdown requested by user")
+            log.info("Shutdown requested by user")
             self.stop()
         except Exception as e:
-            print(f"Unexpected error in main loop: {e}")
+            log.error("Unexpected error in main loop: %s", e)
             self.stop()
     
     def stop(self):
@@ -191,7 +308,9 @@ class PlantMonitor:
         self.is_running = False
         self.display.display_custom_message("System", "Stopped")
         self.buzzer.cleanup()
-        print("Plant Monitor stopped.")
+        log.info("Plant Monitor stopped.")
+        log.persist()
+        log.flush()
 
 # Main execution
 if __name__ == "__main__":
@@ -41,6 +41,20 @@ MAIN_LOOP_DELAY = 6.0  # seconds between readings
 BUZZER_NOTE_DURATION = 0.2  # seconds
 BUZZER_NOTE_PAUSE = 0.05    # seconds between notes
 BUZZER_DUTY_CYCLE = 32768   # 50% duty cycle
+AI_NOTE_GAP = 0.05          # seconds of silence after each AI melody note
+
+# Musical note frequencies (Hz) for AI-generated melodies
+MUSICAL_NOTES = {
+    "C3": 131, "C#3": 139, "D3": 147, "D#3": 156, "E3": 165, "F3": 175, "F#3": 185,
+    "G3": 196, "G#3": 208, "A3": 220, "A#3": 233, "B3": 247,
+    "C4": 262, "C#4": 277, "D4": 294, "D#4": 311, "E4": 330, "F4": 349, "F#4": 370,
+    "G4": 392, "G#4": 415, "A4": 440, "A#4": 466, "B4": 494,
+    "C5": 523, "C#5": 554, "D5": 587, "D#5": 622, "E5": 659, "F5": 698, "F#5": 740,
+    "G5": 784, "G#5": 831, "A5": 880, "A#5": 932, "B5": 988,
+    "C6": 1047, "C#6": 1109, "D6": 1175, "D#6": 1245, "E6": 1319, "F6": 1397, "F#6": 1480,
+    "G6": 1568, "G#6": 1661, "A6": 1760, "A#6": 1865, "B6": 1976,
+    "C7": 2093, "R": 0  # R = Rest/silence
+}
 
 # Display messages
 DISPLAY_MESSAGES = {
@@ -53,6 +67,9 @@ DISPLAY_MESSAGES = {
 # AI and WiFi settings
 ENABLE_AI_MELODIES = True  # Set to False to disable AI features
 AI_REQUEST_INTERVAL = 30   # Seconds between AI melody requests (don't spam the API)
+AI_ASYNC_JOBS = True       # Submit a job and collect the melody on a later cycle instead of waiting
+AI_DEFLATE_WBITS = 10      # Accept deflated responses using a 2**10 byte window (0 = uncompressed only)
+AI_RETRY_KEY_MAX_AGE = 120 # Seconds a request that got no response is retried with the same Idempotency-Key
 WIFI_TIMEOUT = 10         # Seconds to wait for WiFi connection
 MAX_WIFI_RETRIES = 3      # Number of WiFi connection attempts
 
@@ -62,3 +79,43 @@ PLANT_INFO = {
     'location': 'indoor',      # indoor/outdoor/greenhouse
     'name': 'My Plant'         # Name for the AI to reference
 }
+
+# Species threshold profile from the server (looked up by PLANT_INFO['type'])
+PLANT_PROFILE_PATH = "/plant_profile.json"  # Flash copy used until the server answers (None = memory only)
+PROFILE_REFRESH_INTERVAL = 21600            # Seconds between profile revalidations
+
+# Factory melody pack built by tools/melody_pack.py, played when no AI melody is available
+MELODY_PACK_PATH = "/melodies.bin"  # None = standard alerts only
+
+# Battery budget (see utils/energy_manager.py)
+BATTERY_CAPACITY_MAH = 6000  # Usable capacity of the battery pack
+BATTERY_TARGET_DAYS = None   # Lifetime to budget for, e.g. 90 (None = mains powered, only track usage)
+ENERGY_WINDOW = 600          # Seconds of usage averaged before the power level is reconsidered
+ENERGY_RECOVER_RATIO = 0.5   # Step back toward full service when usage falls below this share of budget
+
+# Modelled current draw (mA); measure your board and adjust
+ENERGY_CURRENT_MA = {
+    'cpu': 25,        # Awake and running the loop
+    'idle': 1.5,      # Sleeping between cycles
+    'radio': 80,      # WiFi connecting or in a request
+    'radio_idle': 20, # WiFi associated between requests (power-save mode)
+    'backlight': 15,  # LCD backlight on
+    'buzzer': 20      # PWM tone playing
+}
+
+# Power levels from full service to deepest saving. alerts: 'full' plays every
+# cycle, 'changes' only when the status changes, 'urgent' only on a change to a
+# status that needs attention. backlight_timeout None keeps the backlight on.
+# radio_off switches WiFi off between requests instead of staying associated.
+ENERGY_LEVELS = [
+    {'ai_interval': AI_REQUEST_INTERVAL, 'loop_delay': MAIN_LOOP_DELAY, 'backlight_timeout': None, 'alerts': 'full',
+     'radio_off': False},
+    {'ai_interval': 600, 'loop_delay': 60, 'backlight_timeout': 60, 'alerts': 'changes', 'radio_off': True},
+    {'ai_interval': 3600, 'loop_delay': 300, 'backlight_timeout': 15, 'alerts': 'urgent', 'radio_off': True}
+]
+
+# Logging (see utils/logger.py)
+LOG_LEVEL = "INFO"           # Lowest level kept: DEBUG, INFO, WARNING or ERROR
+LOG_BUFFER_SIZE = 64         # Records buffered between flushes in idle time
+LOG_PERSIST_PATH = "/log.txt"  # Last records saved here on errors and shutdown (None = don't persist)
+LOG_PERSIST_RECORDS = 32     # Records kept in the flash log
@@ -7,16 +7,18 @@ from config import LCD_I2C_ADDRESS, LCD_ROWS, LCD_COLS, DISPLAY_MESSAGES
 class LCDDisplay:
     """Manages LCD display operations for the plant monitoring system"""
     
-    def __init__(self, i2c_address=LCD_I2C_ADDRESS, rows=LCD_ROWS, cols=LCD_COLS):
+    def __init__(self, i2c_address=LCD_I2C_ADDRESS, rows=LCD_ROWS, cols=LCD_COLS, energy=None):
         """Initialize the LCD display
         
         Args:
             i2c_address (int): I2C address of the LCD controller
             rows (int): Number of display rows
             cols (int): Number of display columns
+            energy (EnergyManager): Charged for backlight on-time, if given
         """
         self.rows = rows
         self.cols = cols
+        self.energy = energy
         
         # Initialize I2C and LCD
         self.i2c = board.I2C()
@@ -26,6 +28,27 @@ class LCDDisplay:
             num_cols=cols
         )
         self.lcd.set_cursor_mode(CursorMode.HIDE)
+        
+        # The PCF8574 interface starts with the backlight on
+        self.backlight_on = True
+        if self.energy:
+            self.energy.start('backlight')
+    
+    def set_backlight(self, on):
+        """Switch the backlight, skipping the bus write if it is already in that state
+        
+        Args:
+            on (bool): True to light the display
+        """
+        if on == self.backlight_on:
+            return
+        self.lcd.set_backlight(on)
+        self.backlight_on = on
+        if self.energy:
+            if on:
+                self.energy.start('backlight')
+            else:
+                self.energy.stop('backlight')
     
     def clear(self):
         """Clear the display"""
@@ -1,17 +1,133 @@
-from fastapi import FastAPI
-from pydantic import BaseModel
+from fastapi import FastAPI, Request
+from fastapi.concurrency import run_in_threadpool
+from fastapi.exceptions import RequestValidationError
+from fastapi.responses import JSONResponse, PlainTextResponse, Response
+from pydantic import BaseModel, ValidationError
+from typing import List, Optional
+from contextlib import asynccontextmanager
+import asyncio
 import requests
+import json
+import math
 import os
+import time
+from server.tracing import Tracer, make_exporter, TRACE_HEADER
+from server.admission import AdaptiveLimiter, AdmissionController
+from server.response_cache import ResponseCache, state_key
+from server.upstream import GeminiClient, MockUpstream, ReplayUpstream, RecordingUpstream
+from server.capture import CaptureWriter
+from server.jobs import JobStore
+from server.device_context import DeviceContextStore
+from server.variations import VariationEngine
+from server.anomaly import AnomalyDetector
+from server.fleet_analyzer import FleetAnalyzer, SOIL_STATUSES, AMBIENT_STATUSES, OVERALL_STATUSES, PRIORITY_ACTIONS
+from server.audio_preview import AudioPreviewCache, PREVIEW_CACHE_CONTROL
+from server.compression import CompressionMiddleware, CompressionStats
+from server.profiles import ProfileStore, etag_matches, PROFILE_CACHE_CONTROL
+from server.idempotency import IdempotencyStore, IdempotencyConflict, IDEMPOTENCY_HEADER, REPLAYED_HEADER, MAX_KEY_LENGTH
+from utils.soil_analyzer import PlantAnalyzer
 
-app = FastAPI()
-
-# Get API key from environment variable
+# Get API key from environment variable (checked during startup, not at import)
 API_KEY = os.getenv("GEMINI_API_KEY")
 
-if not API_KEY:
-    raise ValueError("GEMINI_API_KEY environment variable is required")
+# Response cache snapshot preloaded at startup and written at shutdown
+CACHE_SNAPSHOT = os.getenv("RESPONSE_CACHE_SNAPSHOT", "response_cache.json")
+
+# Upstream: "gemini", or "mock" / "replay" to run without the real API
+UPSTREAM_MODE = os.getenv("UPSTREAM_MODE", "gemini")
+UPSTREAM_REPLAY_PATH = os.getenv("UPSTREAM_REPLAY_PATH", "upstream_recordings.jsonl")
+UPSTREAM_RECORD_PATH = os.getenv("UPSTREAM_RECORD_PATH")
+
+# Upstream connections opened before the instance reports ready
+WARMUP_CONNECTIONS = int(os.getenv("WARMUP_CONNECTIONS", "4"))
+WARMUP_ATTEMPTS = 3
+
+# Request tracing: sampled, failed and slow requests are exported
+tracer = Tracer(
+    exporter=make_exporter(
+        path=os.getenv("TRACE_EXPORT_PATH", "traces.jsonl"),
+        collector=os.getenv("TRACE_COLLECTOR")
+    ),
+    sample_rate=float(os.getenv("TRACE_SAMPLE_RATE", "0.01")),
+    slow_ms=float(os.getenv("TRACE_SLOW_MS", "5000"))
+)
+
+# Admission control: adaptive in-flight limit plus a bounded wait queue
+admission = AdmissionController(
+    AdaptiveLimiter(
+        initial_limit=int(os.getenv("INITIAL_IN_FLIGHT", "8")),
+        max_limit=int(os.getenv("MAX_IN_FLIGHT", "32"))
+    ),
+    max_queue=int(os.getenv("MAX_QUEUE", "64")),
+    deadline=float(os.getenv("REQUEST_DEADLINE", "25"))
+)
+
+# Recent responses by plant state, reused as variations and when load is shed
+response_cache = ResponseCache(
+    max_entries=int(os.getenv("RESPONSE_CACHE_SIZE", "2048")),
+    ttl=float(os.getenv("RESPONSE_CACHE_TTL", "3600"))
+)
+
+# Opt-in traffic capture of /consulta requests for tools/replay_traffic.py
+CAPTURE_PATH = os.getenv("CAPTURE_PATH")
+capture = CaptureWriter(CAPTURE_PATH) if CAPTURE_PATH else None
+
+# Cache hits are served as mood-preserving variations; the ratio sets novelty versus upstream cost
+variations = VariationEngine(
+    upstream_ratio=float(os.getenv("VARIATION_UPSTREAM_RATIO", "0.2")),
+    max_reuses=int(os.getenv("VARIATION_MAX_REUSES", "20")),
+    transforms=int(os.getenv("VARIATION_TRANSFORMS", "2"))
+)
+plant_analyzer = PlantAnalyzer()
+fleet_analyzer = FleetAnalyzer()
+
+# Rolling per-device summaries, rendered into the prompt within a fixed token budget
+device_context = DeviceContextStore(token_budget=int(os.getenv("CONTEXT_TOKEN_BUDGET", "24")))
 
-ENDPOINT = f"https://generativelanguage.googleapis.com/v1beta/models/gemini-1.5-flash:generateContent?key={API_KEY}"
+# WAV previews of melodies for the dashboard, cached by content hash
+audio_previews = AudioPreviewCache(max_bytes=int(os.getenv("PREVIEW_CACHE_BYTES", str(32 * 1024 * 1024))))
+
+# Compressed request bodies and responses, negotiated by Content-Encoding / Accept-Encoding.
+# Devices inflate with a fixed window, so COMPRESSION_WBITS must not exceed theirs.
+compression_stats = CompressionStats()
+COMPRESSION_WBITS = int(os.getenv("COMPRESSION_WBITS", "10"))
+COMPRESSION_LEVEL = int(os.getenv("COMPRESSION_LEVEL", "6"))
+COMPRESSION_MIN_BYTES = int(os.getenv("COMPRESSION_MIN_BYTES", "64"))
+
+# Per-species threshold profiles fetched by devices at boot, loaded during startup
+PLANT_PROFILES_PATH = os.getenv("PLANT_PROFILES_PATH", os.path.join(os.path.dirname(__file__), "server", "plant_profiles.json"))
+profiles = ProfileStore()
+
+# Streaming per-device baselines that flag drops, stuck sensors and silent devices
+anomalies = AnomalyDetector(
+    threshold=float(os.getenv("ANOMALY_THRESHOLD", "4.0")),
+    silence_timeout=float(os.getenv("ANOMALY_SILENCE_SECONDS", "900"))
+)
+
+# Asynchronous generations collected by devices on a later cycle
+jobs = JobStore(retention=float(os.getenv("JOB_RETENTION_SECONDS", "900")))
+JOB_POLL_SECONDS = int(os.getenv("JOB_POLL_SECONDS", "10"))
+job_tasks = set()
+
+# Results by Idempotency-Key, so a device retry attaches to the original generation instead of starting another
+idempotency = IdempotencyStore(
+    ttl=float(os.getenv("IDEMPOTENCY_TTL_SECONDS", "600")),
+    max_bytes=int(os.getenv("IDEMPOTENCY_MAX_BYTES", str(4 * 1024 * 1024))),
+    max_keys=int(os.getenv("IDEMPOTENCY_MAX_KEYS", "10000"))
+)
+
+# Upstream client, created during startup
+upstream = None
+
+# Readiness checks filled in by the startup phase
+readiness = {
+    "upstream_configured": False,
+    "templates": False,
+    "profiles": 0,
+    "cache_entries": 0,
+    "upstream_warm": False,
+    "ready": False
+}
 
 TEMPLATE = """
 You are an AI assistant helping to monitor a plant's health. Based on the following data, generate a unique, personalized response each time:
@@ -22,6 +138,7 @@ Plant Data:
 - Soil Moisture Level: {soil_moisture}
 - Temperature: {temperature}°C
 - Humidity: {humidity}%
+- Recent History: {history}
 
 Generate your response in this exact format:
 MESSAGE: [encouraging message - max 16 chars]
@@ -38,31 +155,153 @@ BE CREATIVE - generate a completely different melody each time, even for the sam
 Add variety in rhythm, note patterns, and musical phrases.
 """
 
+GENERATION_CONFIG = {
+    "maxOutputTokens": 200,
+    "temperature": 0.9,  # High creativity for unique melodies
+    "topP": 0.8,
+    "topK": 40
+}
+
+def warm_up_upstream():
+    """Open and warm the upstream connection pool (runs in the worker pool)"""
+    for attempt in range(WARMUP_ATTEMPTS):
+        if upstream.warm_up(WARMUP_CONNECTIONS) > 0:
+            return True
+        print(f"Upstream warm-up attempt {attempt + 1} failed")
+        time.sleep(2 ** attempt)
+    return False
+
+def create_upstream():
+    """Build the configured upstream client, or None if the API key is missing"""
+    if UPSTREAM_MODE == "mock":
+        client = MockUpstream(latency=float(os.getenv("MOCK_UPSTREAM_LATENCY", "0.5")),
+                              failure_rate=float(os.getenv("MOCK_UPSTREAM_FAILURE_RATE", "0.0")))
+    elif UPSTREAM_MODE == "replay":
+        client = ReplayUpstream(UPSTREAM_REPLAY_PATH, use_latency=True)
+    elif API_KEY:
+        client = GeminiClient(API_KEY, pool_size=admission.limiter.max_limit)
+    else:
+        return None
+    if UPSTREAM_RECORD_PATH:
+        client = RecordingUpstream(client, UPSTREAM_RECORD_PATH)
+    return client
+
+async def startup_phase():
+    """Warm everything the first requests would otherwise pay for, then report ready"""
+    global upstream
+    
+    # Templates: format once with sample data so a broken template fails here
+    TEMPLATE.format(location="indoor", plant_type="houseplant", soil_moisture=0.0, temperature=0.0, humidity=0.0,
+                    history="first reading")
+    readiness["templates"] = True
+    
+    # Profiles: a broken profile file keeps the instance from reporting ready
+    try:
+        readiness["profiles"] = profiles.load(PLANT_PROFILES_PATH)
+    except (OSError, ValueError) as e:
+        print(f"Could not load plant profiles: {e}")
+        return
+    
+    # Caches: preload recent responses from the last run
+    if os.path.exists(CACHE_SNAPSHOT):
+        try:
+            readiness["cache_entries"] = response_cache.load(CACHE_SNAPSHOT)
+        except (OSError, ValueError) as e:
+            print(f"Could not load response cache snapshot: {e}")
+    
+    upstream = create_upstream()
+    if upstream is None:
+        print("GEMINI_API_KEY environment variable is required; instance stays not ready")
+        return
+    readiness["upstream_configured"] = True
+    
+    readiness["upstream_warm"] = await run_in_threadpool(warm_up_upstream)
+    if not readiness["upstream_warm"]:
+        print("Upstream warm-up failed; serving anyway with cold connections")
+    readiness["ready"] = True
+
+@asynccontextmanager
+async def lifespan(app):
+    # Warm up in the background so /health answers while /ready holds traffic
+    startup_task = asyncio.create_task(startup_phase())
+    yield
+    startup_task.cancel()
+    tracer.flush()
+    try:
+        response_cache.save(CACHE_SNAPSHOT)
+    except OSError as e:
+        print(f"Could not save response cache snapshot: {e}")
+    if upstream is not None:
+        upstream.close()
+    if capture is not None:
+        capture.close()
+        if capture.skipped:
+            print(f"Capture skipped {capture.skipped} requests with bodies over 64 KiB")
+
+app = FastAPI(lifespan=lifespan)
+app.add_middleware(
+    CompressionMiddleware,
+    stats=compression_stats,
+    window_bits=COMPRESSION_WBITS,
+    level=COMPRESSION_LEVEL,
+    min_size=COMPRESSION_MIN_BYTES
+)
+
 class ContextData(BaseModel):
     location: str
     plant_type: str  
     soil_moisture: float
     temperature: float
     humidity: float
+    device_id: Optional[str] = None
 
-@app.post("/consulta")
-def consulta(data: ContextData):
+class FleetReadings(BaseModel):
+    soil_moisture: List[float]
+    temperature: List[float]
+    humidity: List[float]
+
+def parse_context(body):
+    """Validate a /consulta request body
+
+    Raises:
+        RequestValidationError: If the body is not valid ContextData JSON
+            or a reading is NaN or infinite
+    """
     try:
-        prompt = TEMPLATE.format(**data.dict())
-        
-        payload = {
-            "contents": [{"parts": [{"text": prompt}]}],
-            "generationConfig": {
-                "maxOutputTokens": 200,
-                "temperature": 0.9,  # High creativity for unique melodies
-                "topP": 0.8,
-                "topK": 40
+        data = ContextData(**json.loads(body))
+    except ValidationError as e:
+        raise RequestValidationError(e.errors())
+    except (ValueError, TypeError):
+        raise RequestValidationError([{"loc": ["body"], "msg": "Invalid JSON body", "type": "value_error.jsondecode"}])
+    
+    # json.loads and float fields accept NaN and Infinity, which the cache key and device history cannot bucket
+    errors = [
+        {"loc": ["body", field], "msg": "value is not a finite number", "type": "value_error.float"}
+        for field in ("soil_moisture", "temperature", "humidity")
+        if not math.isfinite(getattr(data, field))
+    ]
+    if errors:
+        raise RequestValidationError(errors)
+    return data
+
+def ask_upstream(data, history, trace, submitted_at):
+    """Build the prompt and call the AI upstream (runs in the worker pool)"""
+    trace.add_span("dispatch", submitted_at, time.perf_counter())
+    try:
+        with trace.span("prompt"):
+            prompt = TEMPLATE.format(history=history, **data.dict())
+            
+            payload = {
+                "contents": [{"parts": [{"text": prompt}]}],
+                "generationConfig": GENERATION_CONFIG
             }
-        }
         
-        headers = {"Content-Type": "application/json"}
+        if upstream is None:
+            return {"error": "AI service not configured"}
         
-        response = requests.post(ENDPOINT, headers=headers, json=payload, timeout=30)
+        with trace.span("upstream"):
+            response = upstream.generate(payload)
+        trace.set("upstream_status", response.status_code)
         
         if response.status_code == 200:
             result = response.json()
@@ -81,6 +320,252 @@ def consulta(data: ContextData):
     except Exception as e:
         return {"error": f"Unexpected error: {str(e)}"}
 
+def vary_cached(key, cached, data, trace):
+    """Serve a cached response with a fresh variation of its melody"""
+    with trace.span("variation"):
+        # The species' thresholds, so the mood matches what the device shows
+        analyzer = profiles.analyzer(data.plant_type, plant_analyzer)
+        mood = analyzer.get_comprehensive_status(data.soil_moisture, data.humidity, data.temperature)['overall_status']
+        text = variations.vary_response(cached, mood)
+    response_cache.count_reuse(key)
+    return text
+
+async def generate(data, trace):
+    """Run a validated request through admission control and the upstream
+    
+    Returns:
+        tuple: (status_code, result dict, extra response headers)
+    """
+    key = state_key(data)
+    with trace.span("context"):
+        history = device_context.observe(data.device_id, data.soil_moisture,
+                                         analyzer=profiles.analyzer(data.plant_type, None))
+        if data.device_id:
+            found = anomalies.observe(data.device_id, data.soil_moisture, data.temperature, data.humidity)
+            if found:
+                trace.set("anomalies", found)
+    
+    with trace.span("cache"):
+        cached = response_cache.get(key)
+    if cached is not None and not variations.should_call_upstream(response_cache.reuses(key)):
+        return 200, {"respuesta": vary_cached(key, cached, data, trace)}, {"X-Served-From": "variation"}
+    
+    queued_at = time.perf_counter()
+    admitted = await admission.acquire()
+    trace.add_span("queue", queued_at, time.perf_counter())
+    
+    if not admitted:
+        # Shed fast: a variation of a recent response for the same state, or tell the device when to retry
+        trace.set("shed", True)
+        if cached is not None:
+            return 200, {"respuesta": vary_cached(key, cached, data, trace)}, {"X-Served-From": "cache"}
+        return 503, {"error": "Server overloaded - retry later"}, {"Retry-After": str(admission.retry_after())}
+    
+    result = None
+    started = time.perf_counter()
+    try:
+        result = await run_in_threadpool(ask_upstream, data, history, trace, time.perf_counter())
+    finally:
+        admission.release(time.perf_counter() - started, result is not None and "error" not in result)
+    
+    if "respuesta" in result:
+        response_cache.put(key, result["respuesta"])
+    elif cached is not None:
+        # A refresh of a cached state failed; the cached response is still good
+        trace.error = result["error"]
+        trace.set("upstream_fallback", True)
+        return 200, {"respuesta": vary_cached(key, cached, data, trace)}, {"X-Served-From": "cache"}
+    return 200, result, {}
+
+def idempotency_key(request, endpoint, data):
+    """Store key for a request's Idempotency-Key header, scoped to the endpoint and device
+
+    Returns:
+        str: Scoped key, or None if the request has no key
+
+    Raises:
+        IdempotencyConflict: If the key is too long to store
+    """
+    key = request.headers.get(IDEMPOTENCY_HEADER)
+    if not key:
+        return None
+    if len(key) > MAX_KEY_LENGTH:
+        raise IdempotencyConflict(f"Idempotency-Key longer than {MAX_KEY_LENGTH} characters")
+    return f"{endpoint}:{data.device_id or ''}:{key}"
+
+async def generate_once(key, body, data, trace):
+    """Run generate() once per idempotency key; retries share its result
+    
+    Errors and shed requests are not kept, so a later retry tries again.
+    
+    Returns:
+        tuple: (status_code, result dict, extra response headers)
+    """
+    entry, owner = idempotency.begin(key, body)
+    if not owner:
+        trace.set("idempotent_replay", True)
+        status_code, result, headers = await entry.wait()
+        return status_code, result, dict(headers, **{REPLAYED_HEADER: "true"})
+    
+    try:
+        status_code, result, headers = await generate(data, trace)
+    except BaseException as e:
+        idempotency.abandon(entry, e if isinstance(e, Exception) else RuntimeError("Original request was cancelled"))
+        raise
+    keep = status_code == 200 and "error" not in result
+    idempotency.finish(entry, (status_code, result, headers), len(result.get("respuesta", "")), keep)
+    return status_code, result, headers
+
+@app.post("/consulta")
+async def consulta(request: Request):
+    arrival = time.monotonic()
+    trace = tracer.start(request.headers.get(TRACE_HEADER))
+    trace.set("device_wifi_ms", request.headers.get("x-device-wifi-ms"))
+    body = b""
+    status_code = 422
+    try:
+        with trace.span("receive"):
+            body = await request.body()
+        
+        with trace.span("validate"):
+            data = parse_context(body)
+        
+        try:
+            key = idempotency_key(request, "consulta", data)
+            if key:
+                status_code, result, headers = await generate_once(key, body, data, trace)
+            else:
+                status_code, result, headers = await generate(data, trace)
+        except IdempotencyConflict as e:
+            status_code, result, headers = 422, {"error": str(e)}, {}
+        if "error" in result:
+            trace.error = result["error"]
+        
+        with trace.span("encode"):
+            response = JSONResponse(result, status_code=status_code, headers=headers)
+        response.headers[TRACE_HEADER] = trace.trace_id
+        return response
+    finally:
+        tracer.finish(trace)
+        if capture is not None:
+            capture.record(arrival, time.monotonic() - arrival, status_code, body)
+
+async def run_job(job, data, trace):
+    """Generate a job's result in the background"""
+    try:
+        status_code, result, headers = await generate(data, trace)
+        if "error" in result:
+            trace.error = result["error"]
+        jobs.complete(job, status_code, result, headers)
+    except Exception as e:
+        trace.error = f"job: {type(e).__name__}"
+        jobs.complete(job, 500, {"error": f"Unexpected error: {str(e)}"})
+    finally:
+        tracer.finish(trace)
+
+@app.post("/consulta/jobs")
+async def submit_job(request: Request):
+    """Accept a generation and return a ticket immediately"""
+    trace = tracer.start(request.headers.get(TRACE_HEADER))
+    trace.set("job", True)
+    with trace.span("receive"):
+        body = await request.body()
+    try:
+        with trace.span("validate"):
+            data = parse_context(body)
+    except RequestValidationError:
+        tracer.finish(trace)
+        raise
+    
+    # A resubmitted job gets the original ticket instead of a second generation
+    entry = None
+    try:
+        key = idempotency_key(request, "jobs", data)
+        if key:
+            entry, owner = idempotency.begin(key, body)
+    except IdempotencyConflict as e:
+        tracer.finish(trace)
+        return JSONResponse({"error": str(e)}, status_code=422)
+    if entry is not None and not owner:
+        job = jobs.get(await entry.wait())
+        if job is not None:
+            tracer.finish(trace)
+            return job_ticket(job, trace, replayed=True)
+        entry = None  # The original job expired first; start a new one
+    
+    job = jobs.create()
+    if entry is not None:
+        idempotency.finish(entry, job.ticket, len(job.ticket))
+    task = asyncio.create_task(run_job(job, data, trace))
+    job_tasks.add(task)
+    task.add_done_callback(job_tasks.discard)
+    return job_ticket(job, trace)
+
+def job_ticket(job, trace, replayed=False):
+    """202 response pointing a device at a job's ticket"""
+    headers = {"Location": f"/consulta/jobs/{job.ticket}", TRACE_HEADER: trace.trace_id}
+    if replayed:
+        headers[REPLAYED_HEADER] = "true"
+    return JSONResponse({"ticket": job.ticket, "retry_after": JOB_POLL_SECONDS}, status_code=202, headers=headers)
+
+@app.get("/consulta/jobs/{ticket}")
+async def collect_job(ticket: str):
+    """Return a job's result, 202 while it is still running, 404 once it expired"""
+    job = jobs.get(ticket)
+    if job is None:
+        return JSONResponse({"error": "Unknown or expired ticket"}, status_code=404)
+    if job.status == "pending":
+        return JSONResponse(
+            {"status": "pending", "retry_after": JOB_POLL_SECONDS},
+            status_code=202,
+            headers={"Retry-After": str(JOB_POLL_SECONDS)}
+        )
+    return JSONResponse(dict(job.result, status="done"), status_code=job.status_code, headers=job.headers)
+
+@app.post("/fleet/analyze")
+def fleet_analyze(readings: FleetReadings):
+    """Classify many readings at once for dashboards and backfills"""
+    if not len(readings.soil_moisture) == len(readings.temperature) == len(readings.humidity):
+        return JSONResponse({"error": "Reading arrays must have the same length"}, status_code=422)
+    result = fleet_analyzer.analyze(readings.soil_moisture, readings.humidity, readings.temperature)
+    return {
+        "codes": {name: codes.tolist() for name, codes in result.items()},
+        "tables": {
+            "soil_status": SOIL_STATUSES,
+            "humidity_status": AMBIENT_STATUSES,
+            "temperature_status": AMBIENT_STATUSES,
+            "overall_status": OVERALL_STATUSES,
+            "priority_action": PRIORITY_ACTIONS
+        },
+        "counts": fleet_analyzer.counts(result)
+    }
+
+@app.get("/preview.wav")
+async def melody_preview(melody: str, request: Request):
+    """Render a melody as the buzzer would play it (square waves, device note gaps)"""
+    try:
+        content_hash, wav = audio_previews.render(melody)
+    except ValueError as e:
+        return JSONResponse({"error": str(e)}, status_code=422)
+    
+    etag = f'"{content_hash}"'
+    headers = {"ETag": etag, "Cache-Control": PREVIEW_CACHE_CONTROL}
+    if etag_matches(request.headers.get("if-none-match"), etag):
+        return Response(status_code=304, headers=headers)
+    return Response(content=wav, media_type="audio/wav", headers=headers)
+
+@app.get("/profiles/{species}")
+async def plant_profile(species: str, request: Request):
+    """Threshold profile for a species; revalidate with If-None-Match for a bodiless 304"""
+    profile = profiles.get(species)
+    if profile is None:
+        return JSONResponse({"error": f"No profile for {species}"}, status_code=404)
+    
+    headers = {"ETag": profile.etag, "Cache-Control": PROFILE_CACHE_CONTROL}
+    if etag_matches(request.headers.get("if-none-match"), profile.etag):
+        return Response(status_code=304, headers=headers)
+    return Response(content=profile.body, media_type="application/json", headers=headers)
+
 @app.get("/")
 def root():
     return {
@@ -92,3 +577,39 @@ def root():
 @app.get("/health")
 def health_check():
     return {"status": "healthy", "service": "plant-melody-api"}
+
+@app.get("/ready")
+def ready_check():
+    """Readiness for load balancers; liveness stays on /health"""
+    return JSONResponse(readiness, status_code=200 if readiness["ready"] else 503)
+
+@app.get("/admission")
+def admission_status():
+    return admission.stats()
+
+@app.get("/anomalies")
+async def anomaly_report():
+    """Devices with active anomalies, silent devices and recent anomaly events"""
+    return {
+        "active": anomalies.active_anomalies(),
+        "silent": [
+            {"device_id": device_id, "silent_seconds": round(seconds)}
+            for device_id, seconds in anomalies.silent_devices()
+        ],
+        "recent": list(anomalies.events)
+    }
+
+@app.get("/metrics")
+async def metrics():
+    """Prometheus text-format metrics"""
+    values = anomalies.metrics()
+    for name, value in admission.stats().items():
+        values[f"admission_{name}"] = value or 0
+    values["response_cache_entries"] = len(response_cache)
+    values["jobs_tracked"] = len(jobs)
+    for name, value in idempotency.stats().items():
+        values[f"idempotency_{name}"] = value
+    for name, value in compression_stats.as_dict().items():
+        values[f"compression_{name}"] = value
+    lines = [f"bioharmony_{name} {value}" for name, value in values.items()]
+    return PlainTextResponse("\n".join(lines) + "\n")
@@ -2,6 +2,7 @@ import board
 import adafruit_dht
 import time
 from config import AMBIENT_SENSOR_PIN
+from utils.logger import log
 
 class DHT11AmbientSensor:
     """Manages DHT11 digital humidity and temperature sensor"""
@@ -26,7 +27,7 @@ class DHT11AmbientSensor:
         self._consecutive_errors = 0
         self._max_consecutive_errors = 3
         
-        print(f"Initialized DHT11 sensor on pin {pin_name}")
+        log.info("Initialized DHT11 sensor on pin %s", pin_name)
     
     def read_humidity_and_temperature(self):
         """Read humidity and temperature from DHT11 sensor
@@ -63,7 +64,7 @@ class DHT11AmbientSensor:
         except RuntimeError as e:
             # DHT sensors commonly throw RuntimeError for timing issues
             self._consecutive_errors += 1
-            print(f"DHT11 read error: {e}")
+            log.warning("DHT11 read error: %s", e)
             
             # Return cached values if available
             if self._last_humidity is not None and self._last_temperature is not None:
@@ -73,7 +74,7 @@ class DHT11AmbientSensor:
         
         except Exception as e:
             self._consecutive_errors += 1
-            print(f"DHT11 unexpected error: {e}")
+            log.error("DHT11 unexpected error: %s", e)
             return None, None
     
     def get_last_readings(self):
@@ -0,0 +1 @@
+"""Support modules for the FastAPI melody server in main.py"""
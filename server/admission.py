@@ -0,0 +1,157 @@
+import asyncio
+from collections import deque
+
+
+class AdaptiveLimiter:
+    """Concurrency limit that follows observed upstream latency
+
+    The limit grows by one slot per window of good samples and shrinks
+    multiplicatively when latency rises well above the best latency seen
+    recently or when the upstream fails.
+    """
+
+    def __init__(self, initial_limit=8, min_limit=1, max_limit=32,
+                 tolerance=2.0, smoothing=0.2, backoff=0.8):
+        """Initialize the limiter
+
+        Args:
+            initial_limit (int): Starting concurrency limit
+            min_limit (int): Lowest limit ever applied
+            max_limit (int): Highest limit ever applied
+            tolerance (float): Latency ratio over baseline treated as overload
+            smoothing (float): EWMA weight of new latency samples
+            backoff (float): Factor applied to the limit on overload
+        """
+        self.limit = float(initial_limit)
+        self.min_limit = min_limit
+        self.max_limit = max_limit
+        self.tolerance = tolerance
+        self.smoothing = smoothing
+        self.backoff = backoff
+        self.baseline_latency = None
+        self.recent_latency = None
+
+    def on_sample(self, latency, ok=True):
+        """Update the limit from a finished upstream call
+
+        Args:
+            latency (float): Upstream call duration in seconds
+            ok (bool): False if the call failed or timed out
+        """
+        if self.recent_latency is None:
+            self.recent_latency = latency
+            self.baseline_latency = latency
+        else:
+            self.recent_latency += self.smoothing * (latency - self.recent_latency)
+            if latency < self.baseline_latency:
+                self.baseline_latency = latency
+            else:
+                # Let the baseline drift up slowly so it tracks upstream changes
+                self.baseline_latency += 0.01 * (latency - self.baseline_latency)
+        
+        if not ok or self.recent_latency > self.baseline_latency * self.tolerance:
+            self.limit = max(self.min_limit, self.limit * self.backoff)
+        else:
+            self.limit = min(self.max_limit, self.limit + 1.0 / self.limit)
+
+    def current_limit(self):
+        """Current limit as a whole number of slots"""
+        return max(self.min_limit, int(self.limit))
+
+
+class AdmissionController:
+    """Bounded in-flight limit with a bounded wait queue
+
+    Must be used from the event loop. Requests that cannot get a slot before
+    their deadline are rejected instead of piling up behind the upstream.
+    """
+
+    def __init__(self, limiter, max_queue=64, deadline=25.0):
+        """Initialize the controller
+
+        Args:
+            limiter (AdaptiveLimiter): Source of the concurrency limit
+            max_queue (int): Requests allowed to wait for a slot
+            deadline (float): Seconds a device waits for a full response
+        """
+        self.limiter = limiter
+        self.max_queue = max_queue
+        self.deadline = deadline
+        self.in_flight = 0
+        self.shed_count = 0
+        self._waiters = deque()
+
+    async def acquire(self):
+        """Wait for an in-flight slot
+
+        Returns:
+            bool: True if a slot was granted, False if the request was shed
+        """
+        if self.in_flight < self.limiter.current_limit() and not self._waiters:
+            self.in_flight += 1
+            return True
+        
+        if len(self._waiters) >= self.max_queue:
+            self.shed_count += 1
+            return False
+        
+        waiter = asyncio.get_running_loop().create_future()
+        self._waiters.append(waiter)
+        try:
+            await asyncio.wait_for(waiter, self.queue_budget())
+            return True
+        except asyncio.TimeoutError:
+            if waiter.done() and not waiter.cancelled():
+                return True  # Slot was handed over as the timeout fired
+            self.shed_count += 1
+            return False
+        except asyncio.CancelledError:
+            if waiter.done() and not waiter.cancelled():
+                self.release()  # Slot was handed over, but the request is gone
+            raise
+        finally:
+            if waiter in self._waiters:
+                self._waiters.remove(waiter)
+
+    def release(self, latency=None, ok=True):
+        """Return a slot and hand it to the next waiter
+
+        Args:
+            latency (float): Upstream call duration in seconds, if one was made
+            ok (bool): False if the upstream call failed
+        """
+        self.in_flight -= 1
+        if latency is not None:
+            self.limiter.on_sample(latency, ok)
+        
+        while self._waiters and self.in_flight < self.limiter.current_limit():
+            waiter = self._waiters.popleft()
+            if not waiter.done():
+                self.in_flight += 1
+                waiter.set_result(True)
+
+    def queue_budget(self):
+        """Seconds a request may wait and still finish within its deadline"""
+        expected = self.limiter.recent_latency or 0.0
+        return max(0.0, self.deadline - expected)
+
+    def retry_after(self):
+        """Suggested Retry-After seconds for a shed request"""
+        expected = self.limiter.recent_latency or 1.0
+        backlog = len(self._waiters) + self.in_flight
+        seconds = expected * backlog / self.limiter.current_limit()
+        return int(min(60, max(1, seconds)))
+
+    def stats(self):
+        """Current admission state
+
+        Returns:
+            dict: Limit, in-flight, queued and shed counts
+        """
+        return {
+            "limit": self.limiter.current_limit(),
+            "in_flight": self.in_flight,
+            "queued": len(self._waiters),
+            "shed": self.shed_count,
+            "recent_latency": self.limiter.recent_latency
+        }
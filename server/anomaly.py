@@ -0,0 +1,209 @@
+import math
+import time
+from collections import OrderedDict, deque
+
+# Readings a device needs before its baseline is trusted
+WARMUP_READINGS = 20
+
+# Hourly means need this many samples before they replace the overall mean
+MIN_HOUR_SAMPLES = 3
+
+# Raw soil values the ADC reports when the probe is disconnected or shorted
+SOIL_LIMITS = (0, 65535)
+
+# Per metric: (flag sudden drops, minimum drop size, identical readings before "stuck")
+# Soil drops are waterings, so only the ambient readings are checked for them.
+# The DHT11 reports whole numbers, so it needs a longer streak to count as stuck.
+METRICS = {
+    'soil': (False, 0.0, 30),
+    'temperature': (True, 3.0, 120),
+    'humidity': (True, 10.0, 120),
+}
+
+
+class MetricBaseline:
+    """EWMA mean and variance of one metric, with per-hour-of-day means"""
+
+    __slots__ = ("mean", "variance", "hour_means", "hour_counts", "last_value", "repeat_count")
+
+    def __init__(self):
+        self.mean = None
+        self.variance = 0.0
+        self.hour_means = [0.0] * 24
+        self.hour_counts = [0] * 24
+        self.last_value = None
+        self.repeat_count = 0
+
+    def expected(self, hour):
+        """Expected value for an hour of day"""
+        if self.hour_counts[hour] >= MIN_HOUR_SAMPLES:
+            return self.hour_means[hour]
+        return self.mean
+
+    def update(self, value, hour, alpha):
+        """Fold one reading into the baseline
+
+        Args:
+            value (float): Reading
+            hour (int): Hour of day of the reading
+            alpha (float): EWMA weight of the new reading
+
+        Returns:
+            float: Deviation from the expected value in standard deviations, before the update
+        """
+        if value == self.last_value:
+            self.repeat_count += 1
+        else:
+            self.repeat_count = 0
+        self.last_value = value
+        
+        if self.mean is None:
+            self.mean = value
+            self.hour_means[hour] = value
+            self.hour_counts[hour] = 1
+            return 0.0
+        
+        residual = value - self.expected(hour)
+        score = residual / math.sqrt(self.variance) if self.variance > 0 else 0.0
+        
+        self.variance = (1 - alpha) * (self.variance + alpha * residual * residual)
+        self.mean += alpha * (value - self.mean)
+        if self.hour_counts[hour] == 0:
+            self.hour_means[hour] = value
+        else:
+            self.hour_means[hour] += alpha * (value - self.hour_means[hour])
+        self.hour_counts[hour] += 1
+        return score
+
+
+class DeviceBaseline:
+    """Baselines and active anomalies of one device"""
+
+    __slots__ = ("metrics", "readings", "last_seen", "active")
+
+    def __init__(self):
+        self.metrics = {name: MetricBaseline() for name in METRICS}
+        self.readings = 0
+        self.last_seen = 0.0
+        self.active = {}
+
+
+class AnomalyDetector:
+    """Incremental fleet anomaly detector
+
+    Every reading updates its device's baseline in O(1) and is checked for
+    sudden drops, stuck sensors and implausible soil values. Devices that
+    stopped reporting are found from the front of a last-seen ordered table,
+    so checking for silence costs only the silent devices.
+    """
+
+    def __init__(self, alpha=0.05, threshold=4.0, silence_timeout=900.0,
+                 max_devices=50000, max_events=1000):
+        """Initialize the detector
+
+        Args:
+            alpha (float): EWMA weight of new readings
+            threshold (float): Standard deviations below expected that count as a sudden drop
+            silence_timeout (float): Seconds without readings before a device is silent
+            max_devices (int): Devices tracked before the least recently seen is dropped
+            max_events (int): Recent anomaly events kept for the endpoint
+        """
+        self.alpha = alpha
+        self.threshold = threshold
+        self.silence_timeout = silence_timeout
+        self.max_devices = max_devices
+        self.events = deque(maxlen=max_events)
+        self.counters = {'readings': 0, 'sudden_drop': 0, 'stuck_sensor': 0, 'soil_out_of_range': 0}
+        self._devices = OrderedDict()
+
+    def observe(self, device_id, soil, temperature, humidity, now=None):
+        """Check a reading and fold it into the device baseline
+
+        Args:
+            device_id (str): Device identifier
+            soil (float): Raw soil reading
+            temperature (float): Ambient temperature in Celsius
+            humidity (float): Ambient humidity percentage
+            now (float): Reading time (epoch seconds), defaults to time.time()
+
+        Returns:
+            list: Anomaly kinds raised by this reading
+        """
+        if now is None:
+            now = time.time()
+        device = self._devices.get(device_id)
+        if device is None:
+            device = DeviceBaseline()
+            self._devices[device_id] = device
+            if len(self._devices) > self.max_devices:
+                self._devices.popitem(last=False)
+        else:
+            self._devices.move_to_end(device_id)
+        
+        self.counters['readings'] += 1
+        device.readings += 1
+        device.last_seen = now
+        hour = time.localtime(now).tm_hour
+        
+        found = []
+        values = {'soil': soil, 'temperature': temperature, 'humidity': humidity}
+        for name, (check_drops, min_drop, stuck_after) in METRICS.items():
+            baseline = device.metrics[name]
+            expected = baseline.expected(hour)
+            score = baseline.update(values[name], hour, self.alpha)
+            if device.readings <= WARMUP_READINGS:
+                continue
+            if check_drops and score < -self.threshold and expected - values[name] >= min_drop:
+                found.append(('sudden_drop', name))
+            if baseline.repeat_count >= stuck_after:
+                found.append(('stuck_sensor', name))
+        
+        if not SOIL_LIMITS[0] < soil < SOIL_LIMITS[1]:
+            found.append(('soil_out_of_range', 'soil'))
+        
+        device.active = {}
+        for kind, metric in found:
+            key = f"{kind}:{metric}"
+            device.active[key] = now
+            self.counters[kind] += 1
+            self.events.append({'device_id': device_id, 'kind': kind, 'metric': metric,
+                                'value': values[metric], 'time': now})
+        return [kind for kind, _ in found]
+
+    def silent_devices(self, now=None):
+        """Devices whose last reading is older than the silence timeout
+
+        Args:
+            now (float): Current epoch seconds, defaults to time.time()
+
+        Returns:
+            list: (device_id, seconds since last reading), most silent first
+        """
+        if now is None:
+            now = time.time()
+        silent = []
+        for device_id, device in self._devices.items():
+            if now - device.last_seen < self.silence_timeout:
+                break
+            silent.append((device_id, now - device.last_seen))
+        return silent
+
+    def active_anomalies(self):
+        """Anomalies raised by each device's latest reading
+
+        Returns:
+            dict: device_id -> list of "kind:metric"
+        """
+        return {device_id: list(device.active) for device_id, device in self._devices.items() if device.active}
+
+    def metrics(self, now=None):
+        """Counters and gauges for the metrics endpoint
+
+        Returns:
+            dict: Metric name -> value
+        """
+        values = {f"anomaly_{name}_total": count for name, count in self.counters.items()}
+        values['anomaly_devices_tracked'] = len(self._devices)
+        values['anomaly_devices_silent'] = len(self.silent_devices(now))
+        values['anomaly_devices_active'] = sum(1 for device in self._devices.values() if device.active)
+        return values
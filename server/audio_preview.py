@@ -0,0 +1,146 @@
+import hashlib
+import io
+import json
+import wave
+from collections import OrderedDict
+import numpy as np
+from config import MUSICAL_NOTES, AI_NOTE_GAP
+
+SAMPLE_RATE = 8000
+AMPLITUDE = 8000
+
+# Longest melody rendered, so a single request cannot ask for minutes of audio
+MAX_PREVIEW_SECONDS = 30.0
+
+# The same melody renders differently after a change to the note table or gap,
+# so these settings are part of every preview's hash and ETag
+RENDER_SETTINGS_DIGEST = hashlib.sha256(
+    json.dumps([sorted(MUSICAL_NOTES.items()), AI_NOTE_GAP, AMPLITUDE]).encode()
+).hexdigest()[:16]
+
+# Revalidated daily rather than immutable: the URL names the melody, not the render settings
+PREVIEW_CACHE_CONTROL = "public, max-age=86400"
+
+
+def parse_for_playback(melody_string):
+    """Read a melody the way BuzzerAlerts.play_ai_melody plays it
+
+    Unknown notes are rests and unreadable durations default to 0.5 s.
+
+    Args:
+        melody_string (str): Melody in format "note,duration,note,duration,..."
+
+    Returns:
+        tuple: (frequencies, durations) float arrays
+
+    Raises:
+        ValueError: If the device would refuse the melody
+    """
+    parts = melody_string.strip().split(",")
+    if len(parts) % 2 != 0:
+        raise ValueError("Invalid melody format: odd number of parts")
+    
+    frequencies = []
+    durations = []
+    for i in range(0, len(parts), 2):
+        frequencies.append(MUSICAL_NOTES.get(parts[i].strip().upper(), 0))
+        try:
+            duration = float(parts[i + 1].strip())
+        except ValueError:
+            duration = 0.5
+        if duration < 0:
+            raise ValueError(f"Negative duration: {parts[i + 1]}")
+        durations.append(duration)
+    
+    if sum(durations) + AI_NOTE_GAP * len(durations) > MAX_PREVIEW_SECONDS:
+        raise ValueError(f"Melody longer than {MAX_PREVIEW_SECONDS:g} seconds")
+    return np.array(frequencies, dtype=np.float64), np.array(durations, dtype=np.float64)
+
+
+def render_square_wave(frequencies, durations, sample_rate=SAMPLE_RATE):
+    """Render notes as 50% duty square waves, each followed by the device's gap
+
+    Every sample is computed in one pass over flat arrays; there is no
+    per-note Python loop.
+
+    Returns:
+        numpy.ndarray: int16 PCM samples
+    """
+    note_samples = np.rint(durations * sample_rate).astype(np.int64)
+    gap_samples = int(round(AI_NOTE_GAP * sample_rate))
+    
+    # Interleave each note with its gap: segment frequencies and lengths
+    segment_freq = np.zeros(len(frequencies) * 2)
+    segment_freq[0::2] = frequencies
+    segment_len = np.full(len(frequencies) * 2, gap_samples, dtype=np.int64)
+    segment_len[0::2] = note_samples
+    
+    freq = np.repeat(segment_freq, segment_len)
+    starts = np.repeat(np.cumsum(segment_len) - segment_len, segment_len)
+    position = np.arange(freq.size) - starts
+    
+    # Phase restarts with each note, like the PWM being re-armed
+    high = np.mod(position * freq / sample_rate, 1.0) < 0.5
+    samples = np.where(high, AMPLITUDE, -AMPLITUDE).astype(np.int16)
+    samples[freq == 0] = 0
+    return samples
+
+
+def encode_wav(samples, sample_rate=SAMPLE_RATE):
+    """Wrap mono int16 samples in a WAV container"""
+    buffer = io.BytesIO()
+    with wave.open(buffer, "wb") as wav:
+        wav.setnchannels(1)
+        wav.setsampwidth(2)
+        wav.setframerate(sample_rate)
+        wav.writeframes(samples.tobytes())
+    return buffer.getvalue()
+
+
+class AudioPreviewCache:
+    """Rendered melody previews keyed by content hash, bounded by total bytes"""
+
+    def __init__(self, max_bytes=32 * 1024 * 1024, sample_rate=SAMPLE_RATE):
+        """Initialize the cache
+
+        Args:
+            max_bytes (int): Total WAV bytes kept before the least recently used are dropped
+            sample_rate (int): Output sample rate
+        """
+        self.max_bytes = max_bytes
+        self.sample_rate = sample_rate
+        self.size = 0
+        self._entries = OrderedDict()
+
+    @staticmethod
+    def content_hash(melody_string, sample_rate=SAMPLE_RATE):
+        """Strong hash of the normalized melody and render settings, used as cache key and ETag"""
+        normalized = ",".join(part.strip().upper() for part in melody_string.strip().split(","))
+        return hashlib.sha256(f"{RENDER_SETTINGS_DIGEST}:{sample_rate}:{normalized}".encode()).hexdigest()[:32]
+
+    def render(self, melody_string):
+        """Get a melody's WAV preview, rendering it on a cache miss
+
+        Args:
+            melody_string (str): Melody in format "note,duration,..."
+
+        Returns:
+            tuple: (content hash, WAV bytes)
+
+        Raises:
+            ValueError: If the melody cannot be played
+        """
+        key = self.content_hash(melody_string, self.sample_rate)
+        wav = self._entries.get(key)
+        if wav is not None:
+            self._entries.move_to_end(key)
+            return key, wav
+        
+        frequencies, durations = parse_for_playback(melody_string)
+        wav = encode_wav(render_square_wave(frequencies, durations, self.sample_rate), self.sample_rate)
+        self._entries[key] = wav
+        self.size += len(wav)
+        while self.size > self.max_bytes and len(self._entries) > 1:
+            _, dropped = self._entries.popitem(last=False)
+            self.size -= len(dropped)
+        return key, wav
@@ -0,0 +1,120 @@
+import gzip
+import struct
+import threading
+import time
+import zlib
+
+CAPTURE_MAGIC = b"BHCAP1"
+
+# Record header: arrival offset ms, server latency ms, status code, body length
+_RECORD = struct.Struct("<IIHH")
+MAX_BODY = 0xFFFF
+_FILE_HEADER = struct.Struct("<6sd")
+
+
+class CaptureWriter:
+    """Records incoming /consulta requests to a compact gzip'd binary file
+
+    Each record stores the arrival offset from the start of the capture, the
+    server latency, the response status and the raw request body. Every
+    flushed chunk is a complete gzip member, so a server that is killed
+    leaves a file readable up to its last flush.
+    """
+
+    def __init__(self, path, flush_every=256):
+        """Open a new capture file
+
+        Args:
+            path (str): Output path (overwritten)
+            flush_every (int): Records buffered before writing to the file
+        """
+        self.path = path
+        self.flush_every = flush_every
+        self.started = time.monotonic()
+        self.count = 0
+        self.skipped = 0
+        self._buffer = []
+        self._lock = threading.Lock()
+        self._file = open(path, "wb")
+        self._write(_FILE_HEADER.pack(CAPTURE_MAGIC, time.time()))
+
+    def _write(self, data):
+        self._file.write(gzip.compress(data))
+        self._file.flush()
+
+    def record(self, arrival, latency, status, body):
+        """Record one request
+
+        Args:
+            arrival (float): time.monotonic() when the request arrived
+            latency (float): Seconds the server took to respond
+            status (int): Response status code
+            body (bytes): Raw request body; bodies over MAX_BODY are counted in skipped
+        """
+        if len(body) > MAX_BODY:
+            # A cut body would replay as a different request
+            with self._lock:
+                self.skipped += 1
+            return
+        offset_ms = int((arrival - self.started) * 1000)
+        header = _RECORD.pack(offset_ms, int(latency * 1000), status, len(body))
+        with self._lock:
+            self._buffer.append(header + body)
+            self.count += 1
+            if len(self._buffer) < self.flush_every:
+                return
+            chunk, self._buffer = b"".join(self._buffer), []
+            self._write(chunk)
+
+    def close(self):
+        """Write buffered records and close the file"""
+        with self._lock:
+            if self._buffer:
+                self._write(b"".join(self._buffer))
+                self._buffer = []
+            self._file.close()
+
+
+def read_capture(path):
+    """Read a capture file
+
+    Args:
+        path (str): File written by CaptureWriter
+
+    A file cut off mid-write, e.g. by a killed server, yields every
+    complete record before the truncated tail.
+
+    Returns:
+        tuple: (start_time, list of (offset_s, latency_s, status, body)) sorted by offset
+    """
+    with open(path, "rb") as f:
+        raw = f.read()
+    data = b""
+    pos = 0
+    while pos < len(raw):
+        member = zlib.decompressobj(16 + zlib.MAX_WBITS)
+        try:
+            data += member.decompress(raw[pos:])
+        except zlib.error:
+            break
+        if not member.eof:
+            break  # Truncated last member
+        pos = len(raw) - len(member.unused_data)
+    if len(data) < _FILE_HEADER.size:
+        raise ValueError(f"{path} is not a BioHarmony capture file")
+    magic, start_time = _FILE_HEADER.unpack_from(data, 0)
+    if magic != CAPTURE_MAGIC:
+        raise ValueError(f"{path} is not a BioHarmony capture file")
+    
+    records = []
+    pos = _FILE_HEADER.size
+    while pos + _RECORD.size <= len(data):
+        offset_ms, latency_ms, status, length = _RECORD.unpack_from(data, pos)
+        pos += _RECORD.size
+        if pos + length > len(data):
+            break
+        records.append((offset_ms / 1000.0, latency_ms / 1000.0, status, data[pos:pos + length]))
+        pos += length
+    # Records from concurrent requests are written in completion order
+    records.sort(key=lambda record: record[0])
+    return start_time, records
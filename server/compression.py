@@ -0,0 +1,261 @@
+import json
+import zlib
+
+# Encodings accepted on requests and offered on responses
+ENCODINGS = ("deflate", "gzip")
+
+# Response types worth compressing; audio and already-compressed bodies pass through
+COMPRESSIBLE_TYPES = ("application/json", "text/")
+
+# zlib's wbits offset for a gzip wrapper instead of the zlib one
+GZIP_WBITS_OFFSET = 16
+
+
+def encode_body(body, encoding, window_bits, level=6):
+    """Compress a body for a Content-Encoding
+
+    "deflate" is the zlib-wrapped stream HTTP means by that name; its header
+    records the window size, so the receiver knows how much memory it needs.
+
+    Args:
+        body (bytes): Uncompressed body
+        encoding (str): "deflate" or "gzip"
+        window_bits (int): Log2 of the LZ77 window (9-15)
+        level (int): zlib compression level
+
+    Returns:
+        bytes: Compressed body
+    """
+    wbits = window_bits + GZIP_WBITS_OFFSET if encoding == "gzip" else window_bits
+    compressor = zlib.compressobj(level, zlib.DEFLATED, wbits)
+    return compressor.compress(body) + compressor.flush()
+
+
+def decode_body(body, encoding, max_size):
+    """Decompress a request body, refusing anything that inflates past max_size
+
+    Args:
+        body (bytes): Compressed body
+        encoding (str): "deflate" or "gzip"
+        max_size (int): Largest decompressed size accepted
+
+    Returns:
+        bytes: Decompressed body
+
+    Raises:
+        ValueError: If the body is corrupt or larger than max_size
+    """
+    # 32 + 15 auto-detects the zlib or gzip header, with any window size
+    decompressor = zlib.decompressobj(32 + 15)
+    try:
+        data = decompressor.decompress(body, max_size + 1)
+    except zlib.error as e:
+        raise ValueError(f"Corrupt {encoding} body: {e}")
+    if len(data) > max_size or decompressor.unconsumed_tail:
+        raise ValueError(f"Body inflates past {max_size} bytes")
+    if not decompressor.eof:
+        raise ValueError(f"Truncated {encoding} body")
+    return data
+
+
+def choose_encoding(accept_encoding):
+    """Pick a response encoding from an Accept-Encoding header
+
+    Deflate is preferred over gzip at equal quality: it is 12 bytes smaller
+    per response and is what devices ask for.
+
+    Returns:
+        str: "deflate", "gzip" or None for identity
+    """
+    best = None
+    best_quality = 0.0
+    for item in accept_encoding.lower().split(","):
+        name, _, params = item.strip().partition(";")
+        if name not in ENCODINGS:
+            continue
+        quality = 1.0
+        params = params.strip()
+        if params.startswith("q="):
+            try:
+                quality = float(params[2:])
+            except ValueError:
+                quality = 0.0
+        if quality > best_quality or (quality == best_quality and name == "deflate"):
+            best, best_quality = name, quality
+    return best
+
+
+class CompressionStats:
+    """Byte counts before and after content coding, for /metrics"""
+
+    def __init__(self):
+        self.responses_compressed = 0
+        self.response_bytes_in = 0
+        self.response_bytes_out = 0
+        self.requests_decoded = 0
+        self.request_bytes_in = 0
+        self.request_bytes_out = 0
+        self.requests_rejected = 0
+
+    def as_dict(self):
+        return dict(vars(self))
+
+
+class CompressionMiddleware:
+    """ASGI middleware negotiating compressed request and response bodies
+
+    Requests with Content-Encoding deflate or gzip are inflated before the
+    app sees them. JSON and text responses of at least min_size bytes are
+    compressed when Accept-Encoding allows it and the result is smaller,
+    unless they carry a strong ETag. The window is 2**window_bits bytes so
+    devices can inflate responses in little memory.
+
+    Args:
+        app: Wrapped ASGI application
+        stats (CompressionStats): Shared counters
+        window_bits (int): Log2 of the compression window (9-15)
+        level (int): zlib compression level
+        min_size (int): Smallest response body worth compressing
+        max_request_bytes (int): Largest inflated request body accepted
+    """
+
+    def __init__(self, app, stats, window_bits=10, level=6, min_size=64, max_request_bytes=256 * 1024):
+        self.app = app
+        self.stats = stats
+        self.window_bits = window_bits
+        self.level = level
+        self.min_size = min_size
+        self.max_request_bytes = max_request_bytes
+
+    async def __call__(self, scope, receive, send):
+        if scope["type"] != "http":
+            await self.app(scope, receive, send)
+            return
+
+        headers = dict(scope["headers"])
+        request_encoding = headers.get(b"content-encoding", b"").decode("latin-1").strip().lower()
+        if request_encoding and request_encoding != "identity":
+            decoded = await self.decode_request(scope, receive, send, request_encoding)
+            if decoded is None:
+                return
+            scope, receive = decoded
+
+        encoding = choose_encoding(headers.get(b"accept-encoding", b"").decode("latin-1"))
+        if encoding is None:
+            await self.app(scope, receive, send)
+        else:
+            await self.app(scope, receive, self.compressing_send(send, encoding))
+
+    async def decode_request(self, scope, receive, send, encoding):
+        """Read and inflate the whole request body
+
+        Returns:
+            tuple: (scope, receive) for the app, or None after an error response was sent
+        """
+        if encoding not in ENCODINGS:
+            await self.reject(send, 415, f"Unsupported Content-Encoding: {encoding}")
+            return None
+
+        chunks = []
+        size = 0
+        more_body = True
+        while more_body:
+            message = await receive()
+            if message["type"] == "http.disconnect":
+                return None
+            chunk = message.get("body", b"")
+            size += len(chunk)
+            if size > self.max_request_bytes:
+                await self.reject(send, 413, "Compressed body too large")
+                return None
+            chunks.append(chunk)
+            more_body = message.get("more_body", False)
+
+        compressed = b"".join(chunks)
+        try:
+            body = decode_body(compressed, encoding, self.max_request_bytes)
+        except ValueError as e:
+            status = 413 if "inflates past" in str(e) else 400
+            await self.reject(send, status, str(e))
+            return None
+        self.stats.requests_decoded += 1
+        self.stats.request_bytes_in += len(compressed)
+        self.stats.request_bytes_out += len(body)
+
+        headers = [
+            (name, value) for name, value in scope["headers"]
+            if name not in (b"content-encoding", b"content-length")
+        ]
+        headers.append((b"content-length", str(len(body)).encode()))
+        scope = dict(scope, headers=headers)
+
+        delivered = False
+
+        async def decoded_receive():
+            nonlocal delivered
+            if not delivered:
+                delivered = True
+                return {"type": "http.request", "body": body, "more_body": False}
+            return await receive()
+
+        return scope, decoded_receive
+
+    def compressing_send(self, send, encoding):
+        """Wrap send so a compressible response body is buffered and compressed"""
+        start = None
+        chunks = []
+        passthrough = False
+
+        async def wrapped(message):
+            nonlocal start, passthrough
+            if passthrough:
+                await send(message)
+                return
+
+            if message["type"] == "http.response.start":
+                headers = dict(message.get("headers", []))
+                content_type = headers.get(b"content-type", b"").decode("latin-1")
+                # A strong ETag names one exact representation, so those bodies are sent as-is
+                etag = headers.get(b"etag", b"")
+                strong_etag = bool(etag) and not etag.startswith(b"W/")
+                if b"content-encoding" in headers or strong_etag or not content_type.startswith(COMPRESSIBLE_TYPES):
+                    passthrough = True
+                    await send(message)
+                else:
+                    start = message
+                return
+
+            chunks.append(message.get("body", b""))
+            if message.get("more_body", False):
+                return
+
+            body = b"".join(chunks)
+            headers = [
+                (name, value) for name, value in start.get("headers", [])
+                if name != b"content-length"
+            ]
+            compressed = encode_body(body, encoding, self.window_bits, self.level) if len(body) >= self.min_size else body
+            # Short JSON such as job tickets can grow; send whichever is smaller
+            if len(compressed) < len(body):
+                self.stats.responses_compressed += 1
+                self.stats.response_bytes_in += len(body)
+                self.stats.response_bytes_out += len(compressed)
+                body = compressed
+                headers.append((b"content-encoding", encoding.encode()))
+            headers.append((b"content-length", str(len(body)).encode()))
+            headers.append((b"vary", b"Accept-Encoding"))
+            await send(dict(start, headers=headers))
+            await send({"type": "http.response.body", "body": body})
+
+        return wrapped
+
+    async def reject(self, send, status, error):
+        """Send a JSON error without calling the app"""
+        self.stats.requests_rejected += 1
+        body = json.dumps({"error": error}).encode()
+        await send({
+            "type": "http.response.start",
+            "status": status,
+            "headers": [(b"content-type", b"application/json"), (b"content-length", str(len(body)).encode())]
+        })
+        await send({"type": "http.response.body", "body": body})
@@ -0,0 +1,155 @@
+import time
+from collections import OrderedDict
+from utils.soil_analyzer import PlantAnalyzer
+
+# A soil reading this much wetter than the previous one counts as a watering
+WATERING_DROP = 2000
+
+# Drying rates (raw units per hour) below this are reported as stable
+STABLE_RATE = 150
+
+# Rough prompt characters per token, used to turn the token budget into characters
+CHARS_PER_TOKEN = 4
+
+
+def format_duration(seconds):
+    """Compact duration for prompts ("45m", "5h", "3d4h")"""
+    minutes = int(seconds // 60)
+    if minutes < 60:
+        return f"{minutes}m"
+    hours = minutes // 60
+    if hours < 24:
+        return f"{hours}h"
+    days, hours = divmod(hours, 24)
+    return f"{days}d{hours}h" if hours else f"{days}d"
+
+
+class DeviceSummary:
+    """Rolling summary of one device's soil readings, updated in O(1)"""
+
+    __slots__ = ("last_soil", "last_seen", "drying_rate", "state", "state_since", "last_watering", "readings")
+
+    def __init__(self):
+        self.last_soil = None
+        self.last_seen = None
+        self.drying_rate = 0.0
+        self.state = None
+        self.state_since = None
+        self.last_watering = None
+        self.readings = 0
+
+    def update(self, soil_value, state, now, smoothing=0.3):
+        """Fold one reading into the summary
+
+        Args:
+            soil_value (float): Raw soil reading (higher is drier)
+            state (str): Soil status for the reading ('dry', 'normal', 'humid')
+            now (float): Reading time in seconds
+            smoothing (float): EWMA weight of the newest drying rate
+        """
+        if self.last_seen is not None and now > self.last_seen:
+            change = soil_value - self.last_soil
+            if change <= -WATERING_DROP:
+                self.last_watering = now
+                self.drying_rate = 0.0
+            else:
+                rate = change * 3600.0 / (now - self.last_seen)
+                self.drying_rate += smoothing * (rate - self.drying_rate)
+        
+        if state != self.state:
+            self.state = state
+            self.state_since = now
+        
+        self.last_soil = soil_value
+        self.last_seen = now
+        self.readings += 1
+
+    def render(self, now, max_chars):
+        """Describe the summary within a fixed character budget
+
+        Parts are added in priority order and dropped once the budget is spent,
+        so the result never grows with the device's history.
+
+        Args:
+            now (float): Current time in seconds
+            max_chars (int): Maximum summary length
+
+        Returns:
+            str: Summary such as "drying (+900/h); watered 2d3h ago; normal for 1d"
+        """
+        if self.readings < 2:
+            return "first reading"
+        
+        if abs(self.drying_rate) < STABLE_RATE:
+            trend = "stable"
+        elif self.drying_rate > 0:
+            trend = f"drying (+{self.drying_rate:.0f}/h)"
+        else:
+            trend = f"getting wetter ({self.drying_rate:.0f}/h)"
+        
+        parts = [trend]
+        if self.last_watering is not None:
+            parts.append(f"watered {format_duration(now - self.last_watering)} ago")
+        else:
+            parts.append("no watering seen")
+        parts.append(f"{self.state} for {format_duration(now - self.state_since)}")
+        
+        summary = ""
+        for part in parts:
+            candidate = f"{summary}; {part}" if summary else part
+            if len(candidate) > max_chars:
+                break
+            summary = candidate
+        return summary
+
+
+class DeviceContextStore:
+    """Per-device rolling summaries for prompt context
+
+    Holds a bounded number of devices; the least recently seen are dropped.
+    Only accessed from the event loop.
+    """
+
+    def __init__(self, token_budget=24, max_devices=50000):
+        """Initialize the store
+
+        Args:
+            token_budget (int): Prompt tokens the summary may use
+            max_devices (int): Devices tracked before the least recent is dropped
+        """
+        self.max_chars = token_budget * CHARS_PER_TOKEN
+        self.max_devices = max_devices
+        self.analyzer = PlantAnalyzer()
+        self._devices = OrderedDict()
+
+    def observe(self, device_id, soil_value, now=None, analyzer=None):
+        """Update a device's summary with its latest reading
+
+        Args:
+            device_id (str): Device identifier, or None for anonymous devices
+            soil_value (float): Raw soil reading
+            now (float): Reading time, defaults to time.monotonic()
+            analyzer (PlantAnalyzer): Species thresholds to classify with, defaults to config.py's
+
+        Returns:
+            str: Rendered summary for the prompt
+        """
+        if not device_id:
+            return "unknown device"
+        if now is None:
+            now = time.monotonic()
+        
+        summary = self._devices.get(device_id)
+        if summary is None:
+            summary = DeviceSummary()
+            self._devices[device_id] = summary
+            if len(self._devices) > self.max_devices:
+                self._devices.popitem(last=False)
+        else:
+            self._devices.move_to_end(device_id)
+        
+        summary.update(soil_value, (analyzer or self.analyzer).interpret_soil_moisture(soil_value), now)
+        return summary.render(now, self.max_chars)
+
+    def __len__(self):
+        return len(self._devices)
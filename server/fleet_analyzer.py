@@ -0,0 +1,117 @@
+import numpy as np
+from config import SOIL_HUMIDITY_THRESHOLDS, AMBIENT_THRESHOLDS
+
+# Code tables: array values index into these, matching PlantAnalyzer's strings
+SOIL_STATUSES = ('dry', 'normal', 'humid')
+AMBIENT_STATUSES = ('normal', 'low', 'high')
+OVERALL_STATUSES = ('good', 'needs_water', 'too_wet', 'dry_air', 'humid_air', 'temp_stress')
+# Each overall status has exactly one priority action, so they share codes
+PRIORITY_ACTIONS = ('monitor', 'water_plant', 'reduce_watering', 'increase_humidity',
+                    'improve_ventilation', 'adjust_temperature')
+
+SOIL_DRY, SOIL_NORMAL, SOIL_HUMID = 0, 1, 2
+AMBIENT_NORMAL, AMBIENT_LOW, AMBIENT_HIGH = 0, 1, 2
+GOOD, NEEDS_WATER, TOO_WET, DRY_AIR, HUMID_AIR, TEMP_STRESS = range(6)
+
+
+class FleetAnalyzer:
+    """Array version of PlantAnalyzer.get_comprehensive_status
+
+    Classifies whole arrays of readings at once with the same rules and
+    threshold comparisons as PlantAnalyzer, returning compact uint8 codes.
+    Thresholds may be scalars or arrays (one per reading, e.g. per species).
+    """
+
+    def __init__(self, soil_thresholds=None, ambient_thresholds=None):
+        """Initialize the analyzer
+
+        Args:
+            soil_thresholds (dict): Custom soil threshold values
+            ambient_thresholds (dict): Custom ambient threshold values
+        """
+        self.soil_thresholds = soil_thresholds or SOIL_HUMIDITY_THRESHOLDS.copy()
+        self.ambient_thresholds = ambient_thresholds or AMBIENT_THRESHOLDS.copy()
+
+    def interpret_soil_moisture(self, soil):
+        """Soil status codes (SOIL_STATUSES) for an array of raw readings"""
+        soil = np.asarray(soil)
+        codes = np.full(soil.shape, SOIL_HUMID, dtype=np.uint8)
+        codes[soil >= self.soil_thresholds['normal']] = SOIL_NORMAL
+        codes[soil > self.soil_thresholds['dry']] = SOIL_DRY
+        return codes
+
+    def _interpret_range(self, values, limits):
+        values = np.asarray(values)
+        codes = np.full(values.shape, AMBIENT_NORMAL, dtype=np.uint8)
+        codes[values > limits['high']] = AMBIENT_HIGH
+        codes[values < limits['low']] = AMBIENT_LOW
+        return codes
+
+    def analyze(self, soil, humidity, temperature):
+        """Classify arrays of readings
+
+        Args:
+            soil (array): Raw soil moisture readings
+            humidity (array): Ambient humidity percentages
+            temperature (array): Ambient temperatures in Celsius
+
+        Returns:
+            dict: uint8 code arrays 'soil_status', 'humidity_status',
+                'temperature_status' and 'overall_status' (also the
+                PRIORITY_ACTIONS code)
+        """
+        soil_status = self.interpret_soil_moisture(soil)
+        humidity_status = self._interpret_range(humidity, self.ambient_thresholds['humidity'])
+        temperature_status = self._interpret_range(temperature, self.ambient_thresholds['temperature'])
+        
+        # Same precedence as PlantAnalyzer: soil first, then humidity, then temperature
+        overall = np.select(
+            [
+                soil_status == SOIL_DRY,
+                soil_status == SOIL_HUMID,
+                humidity_status == AMBIENT_LOW,
+                humidity_status == AMBIENT_HIGH,
+                temperature_status != AMBIENT_NORMAL
+            ],
+            [NEEDS_WATER, TOO_WET, DRY_AIR, HUMID_AIR, TEMP_STRESS],
+            default=GOOD
+        ).astype(np.uint8)
+        
+        return {
+            'soil_status': soil_status,
+            'humidity_status': humidity_status,
+            'temperature_status': temperature_status,
+            'overall_status': overall
+        }
+
+    def counts(self, result):
+        """Number of readings per overall status, for dashboards
+
+        Args:
+            result (dict): Output of analyze()
+
+        Returns:
+            dict: overall status name -> count
+        """
+        totals = np.bincount(result['overall_status'], minlength=len(OVERALL_STATUSES))
+        return {name: int(total) for name, total in zip(OVERALL_STATUSES, totals)}
+
+    @staticmethod
+    def decode(result, index):
+        """Decode one reading's codes into PlantAnalyzer's string form
+
+        Args:
+            result (dict): Output of analyze()
+            index (int): Reading index
+
+        Returns:
+            dict: soil_status, humidity_status, temperature_status, overall_status, priority_action
+        """
+        overall = int(result['overall_status'][index])
+        return {
+            'soil_status': SOIL_STATUSES[result['soil_status'][index]],
+            'humidity_status': AMBIENT_STATUSES[result['humidity_status'][index]],
+            'temperature_status': AMBIENT_STATUSES[result['temperature_status'][index]],
+            'overall_status': OVERALL_STATUSES[overall],
+            'priority_action': PRIORITY_ACTIONS[overall]
+        }
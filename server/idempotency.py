@@ -0,0 +1,171 @@
+import asyncio
+import hashlib
+import time
+from collections import OrderedDict
+
+IDEMPOTENCY_HEADER = "Idempotency-Key"
+REPLAYED_HEADER = "Idempotent-Replayed"
+
+# Keys are opaque to the server; anything longer is rejected rather than stored
+MAX_KEY_LENGTH = 64
+
+# Bookkeeping charged per entry on top of its result, so many tiny results still hit the memory bound
+ENTRY_OVERHEAD_BYTES = 256
+
+
+class IdempotencyConflict(ValueError):
+    """A key was reused with a different request body"""
+
+
+def fingerprint(body):
+    """Short digest identifying a request body"""
+    return hashlib.sha256(body).hexdigest()[:24]
+
+
+class IdempotencyEntry:
+    """One key's request: pending until its result is stored"""
+
+    __slots__ = ("key", "fingerprint", "future", "value", "size", "created", "finished")
+
+    def __init__(self, key, fingerprint):
+        self.key = key
+        self.fingerprint = fingerprint
+        self.future = asyncio.get_running_loop().create_future()
+        self.value = None
+        self.size = ENTRY_OVERHEAD_BYTES
+        self.created = time.monotonic()
+        self.finished = None
+
+    async def wait(self):
+        """The result, once the request that owns the key has finished
+
+        Shielded so a retry that disconnects does not cancel the shared result.
+        """
+        return await asyncio.shield(self.future)
+
+
+class IdempotencyStore:
+    """Results of recent requests by idempotency key
+
+    The first request with a key runs normally; a retry with the same key
+    and body attaches to the in-flight request or gets its stored result.
+    Entries expire ttl seconds after they finish, and the oldest are evicted
+    once the stored results exceed max_bytes or max_keys. Only accessed from
+    the event loop.
+    """
+
+    def __init__(self, ttl=600.0, max_bytes=4 * 1024 * 1024, max_keys=10000):
+        """Initialize the store
+
+        Args:
+            ttl (float): Seconds a finished result is replayed
+            max_bytes (int): Approximate memory held by stored results
+            max_keys (int): Keys held before the oldest are evicted
+        """
+        self.ttl = ttl
+        self.max_bytes = max_bytes
+        self.max_keys = max_keys
+        self._entries = OrderedDict()
+        self.bytes = 0
+        self.attached = 0
+        self.replayed = 0
+        self.conflicts = 0
+        self.evicted = 0
+
+    def begin(self, key, body):
+        """Find the entry for a key, or claim the key for this request
+
+        Args:
+            key (str): Idempotency key, already scoped to the caller
+            body (bytes): Request body
+
+        Returns:
+            tuple: (entry, owner); owner is True if the caller must run the
+            request and call finish(), False if it should wait on the entry
+
+        Raises:
+            IdempotencyConflict: If the key was used with a different body
+        """
+        self._purge()
+        digest = fingerprint(body)
+        entry = self._entries.get(key)
+        if entry is not None:
+            if entry.fingerprint != digest:
+                self.conflicts += 1
+                raise IdempotencyConflict("Idempotency-Key reused with a different request")
+            if entry.finished is None:
+                self.attached += 1
+            else:
+                self.replayed += 1
+            return entry, False
+
+        entry = IdempotencyEntry(key, digest)
+        self._entries[key] = entry
+        self.bytes += entry.size
+        self._evict()
+        return entry, True
+
+    def finish(self, entry, value, size=0, keep=True):
+        """Publish the owner's result to waiting retries
+
+        Args:
+            entry (IdempotencyEntry): Entry returned by begin() with owner True
+            value: Result handed to waiters and replayed to later retries
+            size (int): Approximate bytes the value holds
+            keep (bool): False for results a retry should not reuse, such as
+                errors or shed requests; the key is released immediately
+        """
+        if not entry.future.done():
+            entry.future.set_result(value)
+        if self._entries.get(entry.key) is not entry:
+            return  # Evicted while running
+        if not keep:
+            self._remove(entry.key)
+            return
+        entry.value = value
+        entry.finished = time.monotonic()
+        self.bytes += size
+        entry.size += size
+        self._evict()
+
+    def abandon(self, entry, error):
+        """Fail waiting retries and release the key after the owner raised"""
+        if not entry.future.done():
+            entry.future.set_exception(error)
+            # Retrieved here so an exception nobody waited for is not reported as lost
+            entry.future.exception()
+        if self._entries.get(entry.key) is entry:
+            self._remove(entry.key)
+
+    def _remove(self, key):
+        entry = self._entries.pop(key)
+        self.bytes -= entry.size
+
+    def _evict(self):
+        while self._entries and (self.bytes > self.max_bytes or len(self._entries) > self.max_keys):
+            key = next(iter(self._entries))
+            self._remove(key)
+            self.evicted += 1
+
+    def _purge(self):
+        # Entries are in creation order, which is close enough to finish order for expiry
+        now = time.monotonic()
+        while self._entries:
+            entry = next(iter(self._entries.values()))
+            reference = entry.finished if entry.finished is not None else entry.created
+            if now - reference <= self.ttl:
+                break
+            self._remove(entry.key)
+
+    def stats(self):
+        return {
+            "keys": len(self._entries),
+            "bytes": self.bytes,
+            "attached": self.attached,
+            "replayed": self.replayed,
+            "conflicts": self.conflicts,
+            "evicted": self.evicted
+        }
+
+    def __len__(self):
+        return len(self._entries)
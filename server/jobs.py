@@ -0,0 +1,97 @@
+import secrets
+import time
+from collections import OrderedDict
+
+
+class Job:
+    """A generation submitted through the asynchronous job API"""
+
+    __slots__ = ("ticket", "status", "status_code", "result", "headers", "created", "finished")
+
+    def __init__(self, ticket):
+        self.ticket = ticket
+        self.status = "pending"
+        self.status_code = 202
+        self.result = None
+        self.headers = {}
+        self.created = time.monotonic()
+        self.finished = None
+
+
+class JobStore:
+    """Tickets and results of asynchronous generations
+
+    Finished results are kept for the retention window so a device can collect
+    them on a later wake-up cycle. The number of jobs is bounded; the oldest are
+    dropped first. Only accessed from the event loop.
+    """
+
+    def __init__(self, retention=900.0, max_jobs=10000):
+        """Initialize the store
+
+        Args:
+            retention (float): Seconds a finished result stays collectable
+            max_jobs (int): Jobs kept before the oldest are dropped
+        """
+        self.retention = retention
+        self.max_jobs = max_jobs
+        self._jobs = OrderedDict()
+
+    def create(self):
+        """Create a pending job
+
+        Returns:
+            Job: New job with a unique ticket
+        """
+        self._purge()
+        job = Job(secrets.token_urlsafe(12))
+        self._jobs[job.ticket] = job
+        while len(self._jobs) > self.max_jobs:
+            self._jobs.popitem(last=False)
+        return job
+
+    def complete(self, job, status_code, result, headers=None):
+        """Store a job's result
+
+        Args:
+            job (Job): Job to complete
+            status_code (int): HTTP status to return when the result is collected
+            result (dict): Response body
+            headers (dict): Extra response headers
+        """
+        job.status = "done"
+        job.status_code = status_code
+        job.result = result
+        job.headers = headers or {}
+        job.finished = time.monotonic()
+
+    def get(self, ticket):
+        """Look up a job
+
+        Args:
+            ticket (str): Ticket returned at submission
+
+        Returns:
+            Job: The job, or None if unknown or expired
+        """
+        job = self._jobs.get(ticket)
+        if job is not None and self._is_expired(job, time.monotonic()):
+            del self._jobs[ticket]
+            return None
+        return job
+
+    def _is_expired(self, job, now):
+        # Pending jobs expire too, in case a generation never finishes
+        reference = job.finished if job.finished is not None else job.created
+        return now - reference > self.retention
+
+    def _purge(self):
+        now = time.monotonic()
+        while self._jobs:
+            job = next(iter(self._jobs.values()))
+            if not self._is_expired(job, now):
+                break
+            self._jobs.popitem(last=False)
+
+    def __len__(self):
+        return len(self._jobs)
@@ -0,0 +1,103 @@
+NOTE_NAMES = ("C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B")
+FLATS = {"DB": "C#", "EB": "D#", "GB": "F#", "AB": "G#", "BB": "A#"}
+
+REST = "R"
+
+# Range the prompt asks for: C3 (MIDI 48) to C6 (MIDI 84)
+LOWEST_NOTE = 48
+HIGHEST_NOTE = 84
+
+# Durations accepted from the upstream, in seconds
+MIN_DURATION = 0.05
+MAX_DURATION = 4.0
+
+
+def note_to_midi(name):
+    """Convert a note name such as "C#4" or "Bb3" to a MIDI number
+
+    Args:
+        name (str): Note name, or "R" for a rest
+
+    Returns:
+        int: MIDI note number, or None for a rest
+
+    Raises:
+        ValueError: If the name is not a note
+    """
+    name = name.strip().upper()
+    if name == REST:
+        return None
+    if len(name) < 2 or not name[-1].isdigit():
+        raise ValueError(f"Invalid note: {name}")
+    pitch, octave = name[:-1], int(name[-1])
+    pitch = FLATS.get(pitch, pitch)
+    if pitch not in NOTE_NAMES:
+        raise ValueError(f"Invalid note: {name}")
+    return (octave + 1) * 12 + NOTE_NAMES.index(pitch)
+
+
+def midi_to_note(number):
+    """Convert a MIDI number (or None for a rest) to a note name"""
+    if number is None:
+        return REST
+    octave, index = divmod(number, 12)
+    return f"{NOTE_NAMES[index]}{octave - 1}"
+
+
+def parse_melody(text, strict=True):
+    """Parse "note,duration,note,duration,..." into a list of notes
+
+    Args:
+        text (str): Melody string
+        strict (bool): Also require notes within C3-C6 and sane durations
+
+    Returns:
+        list: (midi number or None for rest, duration seconds) tuples
+
+    Raises:
+        ValueError: If the melody is malformed
+    """
+    parts = [part.strip() for part in text.strip().split(",") if part.strip()]
+    if not parts or len(parts) % 2 != 0:
+        raise ValueError("Melody needs note,duration pairs")
+    
+    notes = []
+    for i in range(0, len(parts), 2):
+        number = note_to_midi(parts[i])
+        duration = float(parts[i + 1])
+        if strict:
+            if number is not None and not LOWEST_NOTE <= number <= HIGHEST_NOTE:
+                raise ValueError(f"Note out of range: {parts[i]}")
+            if not MIN_DURATION <= duration <= MAX_DURATION:
+                raise ValueError(f"Duration out of range: {parts[i + 1]}")
+        notes.append((number, duration))
+    return notes
+
+
+def format_melody(notes):
+    """Format parsed notes back into the device's melody string"""
+    return ",".join(f"{midi_to_note(number)},{duration:g}" for number, duration in notes)
+
+
+def split_response(text):
+    """Split an upstream response into message and melody text
+
+    Mirrors the device's parse_ai_response, without its fallbacks.
+
+    Returns:
+        tuple: (message, melody_text); either is "" if missing
+    """
+    message = ""
+    melody = ""
+    for line in text.strip().split("\n"):
+        line = line.strip()
+        if line.startswith("MESSAGE:"):
+            message = line[len("MESSAGE:"):].strip()
+        elif line.startswith("MELODY:"):
+            melody = line[len("MELODY:"):].strip()
+    return message, melody
+
+
+def format_response(message, melody_text):
+    """Build a response in the format devices parse"""
+    return f"MESSAGE: {message}\nMELODY: {melody_text}"
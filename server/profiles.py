@@ -0,0 +1,125 @@
+import hashlib
+import json
+from utils.soil_analyzer import PlantAnalyzer
+
+# Responses are immutable per ETag; a day's lifetime bounds how long a changed profile takes to reach caches
+PROFILE_CACHE_CONTROL = "public, max-age=86400"
+
+
+def normalize_species(name):
+    """Index key for a species name: "Snake_Plant " and "snake plant" both become "snake-plant" """
+    return "-".join(name.strip().lower().replace("_", " ").replace("-", " ").split())
+
+
+def validate_profile(species, entry):
+    """Check a profile's thresholds have the shape and ordering PlantAnalyzer needs
+
+    Raises:
+        ValueError: If a threshold is missing, not a number or out of order
+    """
+    try:
+        soil = entry["soil"]
+        humidity = entry["ambient"]["humidity"]
+        temperature = entry["ambient"]["temperature"]
+        pairs = (
+            ("soil", soil["normal"], soil["dry"]),
+            ("humidity", humidity["low"], humidity["high"]),
+            ("temperature", temperature["low"], temperature["high"])
+        )
+    except (KeyError, TypeError) as e:
+        raise ValueError(f"Profile {species!r} is missing {e}")
+    for name, low, high in pairs:
+        if not all(isinstance(value, (int, float)) for value in (low, high)):
+            raise ValueError(f"Profile {species!r} has non-numeric {name} thresholds")
+        if low >= high:
+            raise ValueError(f"Profile {species!r} has {name} thresholds out of order")
+
+
+def etag_matches(if_none_match, etag):
+    """Whether an If-None-Match header covers this ETag
+
+    Uses the weak comparison If-None-Match calls for, so a W/ tag from an
+    intermediary that recompressed the body still matches.
+    """
+    if not if_none_match:
+        return False
+    if if_none_match.strip() == "*":
+        return True
+    opaque = etag[2:] if etag.startswith("W/") else etag
+    for tag in if_none_match.split(","):
+        tag = tag.strip()
+        if (tag[2:] if tag.startswith("W/") else tag) == opaque:
+            return True
+    return False
+
+
+class PlantProfile:
+    """A served profile: the response body, its strong ETag and an analyzer with its thresholds, built once"""
+
+    __slots__ = ("species", "body", "etag", "analyzer")
+
+    def __init__(self, species, entry):
+        self.species = species
+        document = {
+            "species": species,
+            "name": entry.get("name", species),
+            "soil": entry["soil"],
+            "ambient": entry["ambient"]
+        }
+        self.body = json.dumps(document, separators=(",", ":"), sort_keys=True).encode()
+        self.etag = '"' + hashlib.sha256(self.body).hexdigest()[:24] + '"'
+        # Classifies readings the way a device with this profile does
+        self.analyzer = PlantAnalyzer()
+        self.analyzer.apply_profile(document)
+
+
+class ProfileStore:
+    """Per-species threshold profiles indexed by normalized name
+
+    Bodies and ETags are built when the file is loaded, so a lookup is a
+    single dict access regardless of how many profiles there are. Aliases
+    share their species' profile object.
+    """
+
+    def __init__(self):
+        self.by_species = {}
+        self.profile_count = 0
+
+    def load(self, path):
+        """Load profiles from a JSON file of {species: profile}, replacing the current set
+
+        Returns:
+            int: Number of profiles loaded
+
+        Raises:
+            ValueError: If a profile is invalid or two names collide
+        """
+        with open(path) as f:
+            entries = json.load(f)
+
+        index = {}
+        for name, entry in entries.items():
+            species = normalize_species(name)
+            validate_profile(species, entry)
+            profile = PlantProfile(species, entry)
+            for key in [species] + [normalize_species(alias) for alias in entry.get("aliases", [])]:
+                if key in index:
+                    raise ValueError(f"Duplicate profile name {key!r}")
+                index[key] = profile
+
+        # Swap in one assignment so lookups never see a half-loaded index
+        self.by_species = index
+        self.profile_count = len(entries)
+        return self.profile_count
+
+    def get(self, species):
+        """Profile for a species name or alias, or None"""
+        return self.by_species.get(normalize_species(species))
+
+    def analyzer(self, species, default):
+        """PlantAnalyzer with a species' thresholds, or default if it has no profile"""
+        profile = self.get(species)
+        return profile.analyzer if profile is not None else default
+
+    def __len__(self):
+        return self.profile_count
@@ -0,0 +1,127 @@
+import json
+import time
+from collections import OrderedDict
+
+# Bucket sizes used to decide that two readings describe the same plant state
+SOIL_BUCKET = 1000
+TEMPERATURE_BUCKET = 2.0
+HUMIDITY_BUCKET = 5.0
+
+
+def state_key(data):
+    """Build a cache key from a /consulta request
+
+    Readings are bucketed so that nearby values share generated responses.
+
+    Args:
+        data (ContextData): Validated request
+
+    Returns:
+        tuple: Hashable plant state key
+    """
+    return (
+        data.plant_type.lower(),
+        data.location.lower(),
+        int(data.soil_moisture // SOIL_BUCKET),
+        int(data.temperature // TEMPERATURE_BUCKET),
+        int(data.humidity // HUMIDITY_BUCKET)
+    )
+
+
+class ResponseCache:
+    """Bounded LRU cache of upstream responses by plant state
+
+    Entries also count how often they were reused, so callers can decide when
+    a response is stale enough to regenerate.
+
+    Only accessed from the event loop, so it needs no locking.
+    """
+
+    def __init__(self, max_entries=2048, ttl=3600.0):
+        """Initialize the cache
+
+        Args:
+            max_entries (int): Entries kept before the least recently used is evicted
+            ttl (float): Seconds a response stays usable
+        """
+        self.max_entries = max_entries
+        self.ttl = ttl
+        self._entries = OrderedDict()
+
+    def get(self, key):
+        """Get a cached response text
+
+        Args:
+            key (tuple): Key from state_key()
+
+        Returns:
+            str: Cached response text, or None if missing or expired
+        """
+        entry = self._entries.get(key)
+        if entry is None:
+            return None
+        if time.monotonic() - entry[1] > self.ttl:
+            del self._entries[key]
+            return None
+        self._entries.move_to_end(key)
+        return entry[0]
+
+    def reuses(self, key):
+        """Number of times the cached response was served in place of a fresh one"""
+        entry = self._entries.get(key)
+        return entry[2] if entry is not None else 0
+
+    def count_reuse(self, key):
+        """Record that the cached response was served again"""
+        entry = self._entries.get(key)
+        if entry is not None:
+            entry[2] += 1
+
+    def put(self, key, text):
+        """Store a response text, resetting its reuse count
+
+        Args:
+            key (tuple): Key from state_key()
+            text (str): Upstream response text
+        """
+        self._entries[key] = [text, time.monotonic(), 0]
+        self._entries.move_to_end(key)
+        while len(self._entries) > self.max_entries:
+            self._entries.popitem(last=False)
+
+    def save(self, path):
+        """Write unexpired entries to a snapshot file
+
+        Args:
+            path (str): Snapshot file path
+        """
+        now = time.monotonic()
+        entries = [
+            [list(key), text, now - stored_at]
+            for key, (text, stored_at, _) in self._entries.items()
+            if now - stored_at <= self.ttl
+        ]
+        with open(path, "w") as f:
+            json.dump(entries, f)
+
+    def load(self, path):
+        """Preload entries from a snapshot file, keeping their age
+
+        Args:
+            path (str): Snapshot file path
+
+        Returns:
+            int: Number of entries loaded
+        """
+        with open(path) as f:
+            entries = json.load(f)
+        now = time.monotonic()
+        for key, text, age in entries:
+            if age <= self.ttl:
+                self._entries[tuple(key)] = [text, now - age, 0]
+        while len(self._entries) > self.max_entries:
+            self._entries.popitem(last=False)
+        return len(self._entries)
+
+    def __len__(self):
+        return len(self._entries)
@@ -0,0 +1,243 @@
+import json
+import random
+import socket
+import threading
+import time
+import zlib
+
+# Header the device uses to propagate its trace id
+TRACE_HEADER = "x-trace-id"
+
+# Longest trace id accepted from a device; anything longer is replaced
+MAX_TRACE_ID_LENGTH = 64
+
+
+class _SpanScope:
+    """Context manager that records one span on exit"""
+
+    __slots__ = ("trace", "name", "start")
+
+    def __init__(self, trace, name):
+        self.trace = trace
+        self.name = name
+        self.start = 0.0
+
+    def __enter__(self):
+        self.start = time.perf_counter()
+        return self
+
+    def __exit__(self, exc_type, exc, tb):
+        self.trace.add_span(self.name, self.start, time.perf_counter())
+        if exc_type is not None and self.trace.error is None:
+            self.trace.error = f"{self.name}: {exc_type.__name__}"
+        return False
+
+
+class RequestTrace:
+    """Spans collected for a single request
+
+    Spans are plain tuples timed with perf_counter, so recording them is cheap
+    enough to do for every request; only traces picked by the tracer are
+    serialized and exported.
+    """
+
+    def __init__(self, trace_id, sampled):
+        """Start a trace
+
+        Args:
+            trace_id (str): Trace id propagated from the device or generated
+            sampled (bool): True if head sampling selected this trace
+        """
+        self.trace_id = trace_id
+        self.sampled = sampled
+        self.spans = []
+        self.attributes = {}
+        self.error = None
+        self.start_time = time.time()
+        self._origin = time.perf_counter()
+
+    def span(self, name):
+        """Time a block of code as a named span
+
+        Args:
+            name (str): Span name (receive, validate, upstream, ...)
+
+        Returns:
+            _SpanScope: Context manager recording the span
+        """
+        return _SpanScope(self, name)
+
+    def add_span(self, name, start, end):
+        """Record a span measured elsewhere
+
+        Args:
+            name (str): Span name
+            start (float): perf_counter value at span start
+            end (float): perf_counter value at span end
+        """
+        self.spans.append((name, start, end))
+
+    def set(self, key, value):
+        """Attach an attribute to the trace (ignored when value is None)"""
+        if value is not None:
+            self.attributes[key] = value
+
+    def duration_ms(self):
+        """Milliseconds elapsed since the trace started"""
+        return (time.perf_counter() - self._origin) * 1000.0
+
+    def to_record(self):
+        """Serialize the trace for export
+
+        Returns:
+            dict: Trace with span offsets and durations in milliseconds
+        """
+        origin = self._origin
+        return {
+            "trace_id": self.trace_id,
+            "start": round(self.start_time, 3),
+            "duration_ms": round(self.duration_ms(), 3),
+            "sampled": self.sampled,
+            "error": self.error,
+            "attributes": self.attributes,
+            "spans": [
+                {
+                    "name": name,
+                    "offset_ms": round((start - origin) * 1000.0, 3),
+                    "duration_ms": round((end - start) * 1000.0, 3),
+                }
+                for name, start, end in self.spans
+            ],
+        }
+
+
+class FileSpanExporter:
+    """Appends traces as JSON lines to a local file, in batches"""
+
+    def __init__(self, path, batch_size=64):
+        """Initialize the exporter
+
+        Args:
+            path (str): Output file, opened in append mode
+            batch_size (int): Traces buffered before writing to disk
+        """
+        self.path = path
+        self.batch_size = batch_size
+        self._buffer = []
+        self._lock = threading.Lock()
+
+    def export(self, record):
+        with self._lock:
+            self._buffer.append(json.dumps(record, separators=(",", ":")))
+            if len(self._buffer) < self.batch_size:
+                return
+            lines, self._buffer = self._buffer, []
+        self._write(lines)
+
+    def flush(self):
+        with self._lock:
+            lines, self._buffer = self._buffer, []
+        if lines:
+            self._write(lines)
+
+    def _write(self, lines):
+        with open(self.path, "a") as f:
+            f.write("\n".join(lines) + "\n")
+
+
+class UdpSpanExporter:
+    """Sends each trace as one JSON datagram to a local collector"""
+
+    def __init__(self, host, port):
+        """Initialize the exporter
+
+        Args:
+            host (str): Collector host
+            port (int): Collector UDP port
+        """
+        self.address = (host, port)
+        self._sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+
+    def export(self, record):
+        try:
+            self._sock.sendto(json.dumps(record, separators=(",", ":")).encode(), self.address)
+        except OSError:
+            pass  # Tracing must never fail a request
+
+    def flush(self):
+        pass
+
+
+def make_exporter(path=None, collector=None):
+    """Build an exporter from configuration
+
+    Args:
+        path (str): JSON lines file to append traces to
+        collector (str): "host:port" of a UDP collector, takes precedence over path
+
+    Returns:
+        Exporter instance, or None if tracing export is disabled
+    """
+    if collector:
+        host, _, port = collector.rpartition(":")
+        return UdpSpanExporter(host or "127.0.0.1", int(port))
+    if path:
+        return FileSpanExporter(path)
+    return None
+
+
+class Tracer:
+    """Creates request traces and decides which ones get exported
+
+    Sampling is decided from the trace id, so the device and any other hop
+    agree on it. Failed and slow requests are always exported, whatever the
+    sample rate.
+    """
+
+    def __init__(self, exporter=None, sample_rate=0.01, slow_ms=5000.0):
+        """Initialize the tracer
+
+        Args:
+            exporter: FileSpanExporter, UdpSpanExporter or None to disable export
+            sample_rate (float): Fraction of traces exported (0.0 - 1.0)
+            slow_ms (float): Requests slower than this are always exported
+        """
+        self.exporter = exporter
+        self.sample_rate = sample_rate
+        self.slow_ms = slow_ms
+
+    def start(self, trace_id=None):
+        """Start tracing a request
+
+        Args:
+            trace_id (str): Trace id from the device header, if any
+
+        Returns:
+            RequestTrace: New trace
+        """
+        if not trace_id or len(trace_id) > MAX_TRACE_ID_LENGTH:
+            trace_id = "%016x" % random.getrandbits(64)
+        return RequestTrace(trace_id, self._is_sampled(trace_id))
+
+    def finish(self, trace):
+        """Export the trace if it was sampled, failed or slow
+
+        Args:
+            trace (RequestTrace): Finished trace
+        """
+        if self.exporter is None:
+            return
+        if trace.sampled or trace.error or trace.duration_ms() >= self.slow_ms:
+            self.exporter.export(trace.to_record())
+
+    def flush(self):
+        """Write out any buffered traces"""
+        if self.exporter is not None:
+            self.exporter.flush()
+
+    def _is_sampled(self, trace_id):
+        if self.sample_rate >= 1.0:
+            return True
+        if self.sample_rate <= 0.0:
+            return False
+        return (zlib.crc32(trace_id.encode()) / 4294967296.0) < self.sample_rate
@@ -0,0 +1,267 @@
+import itertools
+import json
+import random
+import threading
+import time
+import requests
+from requests.adapters import HTTPAdapter
+
+API_BASE = "https://generativelanguage.googleapis.com/v1beta/models"
+
+
+class GeminiClient:
+    """Gemini API client with a pooled, pre-warmed HTTPS session"""
+
+    def __init__(self, api_key, model="gemini-1.5-flash", pool_size=32, timeout=30):
+        """Initialize the client
+
+        Args:
+            api_key (str): Gemini API key
+            model (str): Model name
+            pool_size (int): Connections kept open to the upstream
+            timeout (float): Seconds before an upstream call times out
+        """
+        self.model_url = f"{API_BASE}/{model}?key={api_key}"
+        self.endpoint = f"{API_BASE}/{model}:generateContent?key={api_key}"
+        self.timeout = timeout
+        self.session = requests.Session()
+        self.session.headers.update({"Content-Type": "application/json"})
+        self.session.mount("https://", HTTPAdapter(pool_connections=1, pool_maxsize=pool_size))
+
+    def warm_up(self, connections=4):
+        """Open pooled TLS connections ahead of the first request
+
+        Fetches model metadata on several connections at once, so DNS, TCP and
+        TLS setup are done and the connections stay in the pool.
+
+        Args:
+            connections (int): Connections to open in parallel
+
+        Returns:
+            int: Number of connections that completed a request
+        """
+        results = []
+
+        def fetch():
+            try:
+                response = self.session.get(self.model_url, timeout=self.timeout)
+                results.append(response.status_code == 200)
+            except requests.exceptions.RequestException:
+                results.append(False)
+
+        threads = [threading.Thread(target=fetch) for _ in range(connections)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        return sum(results)
+
+    def generate(self, payload):
+        """Send a generateContent request
+
+        Args:
+            payload (dict): Gemini request body
+
+        Returns:
+            requests.Response: Upstream response
+        """
+        return self.session.post(self.endpoint, json=payload, timeout=self.timeout)
+
+    def close(self):
+        self.session.close()
+
+
+class UpstreamResponse:
+    """Minimal stand-in for requests.Response returned by offline upstreams"""
+
+    def __init__(self, status_code, body):
+        self.status_code = status_code
+        self._body = body
+        self.text = json.dumps(body)
+
+    def json(self):
+        return self._body
+
+
+def estimate_tokens(text):
+    """Rough token count (about four characters per token)"""
+    return max(1, len(text) // 4)
+
+
+def gemini_body(text, prompt):
+    """Wrap generated text in a Gemini generateContent response body"""
+    return {
+        "candidates": [{"content": {"parts": [{"text": text}]}}],
+        "usageMetadata": {
+            "promptTokenCount": estimate_tokens(prompt),
+            "candidatesTokenCount": estimate_tokens(text)
+        }
+    }
+
+
+class MockUpstream:
+    """Offline upstream that answers like Gemini
+
+    Generates random melodies in the device format, truncated at
+    maxOutputTokens like the real model, with a configurable latency and
+    failure rate. Higher temperatures produce more malformed output.
+    """
+
+    MESSAGES = ("Feeling great!", "Water me pls", "Too soggy!", "Need moisture", "Fresh air pls", "Brrr, cold!")
+    NOTES = ("C4", "D4", "E4", "F4", "G4", "A4", "B4", "C5", "D5", "E5", "R")
+    DURATIONS = ("0.25", "0.5", "0.5", "1.0")
+
+    def __init__(self, latency=0.0, failure_rate=0.0, seed=None):
+        """Initialize the mock
+
+        Args:
+            latency (float): Seconds each call takes
+            failure_rate (float): Fraction of calls answered with HTTP 500
+            seed (int): Random seed, for reproducible runs
+        """
+        self.latency = latency
+        self.failure_rate = failure_rate
+        self.rng = random.Random(seed)
+        self.lock = threading.Lock()
+
+    def warm_up(self, connections=4):
+        return connections
+
+    def generate(self, payload):
+        prompt = payload["contents"][0]["parts"][0]["text"]
+        config = payload.get("generationConfig", {})
+        with self.lock:
+            failed = self.rng.random() < self.failure_rate
+            text = self._compose(config)
+        if self.latency:
+            time.sleep(self.latency)
+        if failed:
+            return UpstreamResponse(500, {"error": {"code": 500, "message": "Mock upstream failure"}})
+        return UpstreamResponse(200, gemini_body(text, prompt))
+
+    def compose(self, config):
+        """Response text the mock would answer with, for building offline fixtures
+
+        Args:
+            config (dict): generationConfig (temperature, maxOutputTokens)
+
+        Returns:
+            str: Model text with MESSAGE and MELODY lines
+        """
+        with self.lock:
+            return self._compose(config)
+
+    def _compose(self, config):
+        note_count = self.rng.randint(4, 12)
+        melody = ",".join(
+            f"{self.rng.choice(self.NOTES)},{self.rng.choice(self.DURATIONS)}" for _ in range(note_count)
+        )
+        text = f"MESSAGE: {self.rng.choice(self.MESSAGES)}\nMELODY: {melody}"
+        if self.rng.random() < 0.05 * config.get("temperature", 1.0):
+            text = text.replace("MELODY: ", "Here is a melody: ")
+        return text[:config.get("maxOutputTokens", 200) * 4]
+
+    def close(self):
+        pass
+
+
+def request_key(prompt, config):
+    """Key matching a request to its recording: the prompt and its generationConfig"""
+    return prompt, json.dumps(config, sort_keys=True)
+
+
+class ReplayUpstream:
+    """Offline upstream that answers with recorded responses
+
+    Recordings are JSON lines of {"prompt", "generation_config", "response",
+    "latency"}. A request recorded with the same prompt and generationConfig
+    gets its own response back; recordings without a generation_config match
+    on the prompt alone. Other requests get the recordings in turn.
+    """
+
+    def __init__(self, path, use_latency=False):
+        """Load recordings
+
+        Args:
+            path (str): JSON lines file written by RecordingUpstream
+            use_latency (bool): Sleep for each recording's original latency
+        """
+        self.use_latency = use_latency
+        self.recordings = []
+        self.by_request = {}
+        self.by_prompt = {}
+        with open(path) as f:
+            for line in f:
+                if line.strip():
+                    record = json.loads(line)
+                    if "generation_config" in record:
+                        self.by_request.setdefault(request_key(record["prompt"], record["generation_config"]), record)
+                    else:
+                        self.by_prompt.setdefault(record["prompt"], record)
+                    self.recordings.append(record)
+        if not self.recordings:
+            raise ValueError(f"No recordings in {path}")
+        self.next_index = itertools.count()
+
+    def warm_up(self, connections=4):
+        return connections
+
+    def find(self, prompt, config):
+        """The recording of a request, or None if it was not recorded"""
+        return self.by_request.get(request_key(prompt, config)) or self.by_prompt.get(prompt)
+
+    def has_recording(self, prompt, config=None):
+        """True if the request was recorded, so its own response is replayed"""
+        return self.find(prompt, config) is not None
+
+    def generate(self, payload):
+        prompt = payload["contents"][0]["parts"][0]["text"]
+        record = self.find(prompt, payload.get("generationConfig"))
+        if record is None:
+            record = self.recordings[next(self.next_index) % len(self.recordings)]
+        if self.use_latency:
+            time.sleep(record.get("latency", 0.0))
+        return UpstreamResponse(record.get("status", 200), record["response"])
+
+    def close(self):
+        pass
+
+
+class RecordingUpstream:
+    """Wraps an upstream and appends every exchange to a recording file"""
+
+    def __init__(self, inner, path):
+        """Initialize the recorder
+
+        Args:
+            inner: Upstream to forward calls to
+            path (str): JSON lines file to append recordings to
+        """
+        self.inner = inner
+        self.path = path
+        self.lock = threading.Lock()
+
+    def warm_up(self, connections=4):
+        return self.inner.warm_up(connections)
+
+    def generate(self, payload):
+        started = time.perf_counter()
+        response = self.inner.generate(payload)
+        try:
+            body = response.json()
+        except ValueError:
+            body = {"raw": response.text}
+        record = {
+            "prompt": payload["contents"][0]["parts"][0]["text"],
+            "generation_config": payload.get("generationConfig"),
+            "status": response.status_code,
+            "response": body,
+            "latency": round(time.perf_counter() - started, 3)
+        }
+        with self.lock:
+            with open(self.path, "a") as f:
+                f.write(json.dumps(record) + "\n")
+        return response
+
+    def close(self):
+        self.inner.close()
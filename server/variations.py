@@ -0,0 +1,158 @@
+import random
+from server.melody import (
+    parse_melody, format_melody, split_response, format_response,
+    LOWEST_NOTE, HIGHEST_NOTE
+)
+
+# Transformations that keep each plant mood recognisable, and the transposition
+# range (semitones) allowed for it. Inversion turns bright phrases dark, so only
+# somber moods use it; ornaments are kept off the gentle, pleading ones.
+MOOD_PROFILES = {
+    'good': (("transpose", "retrograde", "rhythm", "ornament"), (-2, 5)),
+    'needs_water': (("transpose", "retrograde", "rhythm", "inversion"), (-5, 2)),
+    'too_wet': (("transpose", "rhythm", "ornament", "retrograde"), (-2, 5)),
+    'dry_air': (("transpose", "retrograde", "rhythm", "inversion"), (-3, 3)),
+    'humid_air': (("transpose", "retrograde", "rhythm", "ornament"), (-3, 3)),
+    'temp_stress': (("transpose", "rhythm", "ornament", "inversion"), (-3, 3)),
+}
+DEFAULT_PROFILE = (("transpose", "retrograde", "rhythm"), (-3, 3))
+
+# Ornament: a short upper neighbour taken from the start of a long note
+ORNAMENT_DURATION = 0.125
+ORNAMENT_MIN_NOTE = 0.5
+
+
+def pitch_bounds(notes):
+    pitches = [number for number, _ in notes if number is not None]
+    if not pitches:
+        return None, None
+    return min(pitches), max(pitches)
+
+
+def transpose(notes, semitones):
+    """Shift every note, reduced so the melody stays within C3-C6"""
+    low, high = pitch_bounds(notes)
+    if low is None:
+        return list(notes)
+    semitones = max(LOWEST_NOTE - low, min(HIGHEST_NOTE - high, semitones))
+    return [(None if number is None else number + semitones, duration) for number, duration in notes]
+
+
+def invert(notes):
+    """Mirror the melody around its first note, moved by octaves back into range"""
+    low, _ = pitch_bounds(notes)
+    if low is None:
+        return list(notes)
+    axis = next(number for number, _ in notes if number is not None)
+    inverted = []
+    for number, duration in notes:
+        if number is not None:
+            number = 2 * axis - number
+            while number < LOWEST_NOTE:
+                number += 12
+            while number > HIGHEST_NOTE:
+                number -= 12
+        inverted.append((number, duration))
+    return inverted
+
+
+def retrograde(notes):
+    """Play the melody backwards"""
+    return list(reversed(notes))
+
+
+def permute_rhythm(notes, rng):
+    """Reassign the melody's durations to different notes; total length is unchanged"""
+    durations = [duration for _, duration in notes]
+    rng.shuffle(durations)
+    return [(number, duration) for (number, _), duration in zip(notes, durations)]
+
+
+def ornament(notes, rng):
+    """Add an upper-neighbour grace note before one long note"""
+    candidates = [
+        i for i, (number, duration) in enumerate(notes)
+        if number is not None and duration >= ORNAMENT_MIN_NOTE and number + 2 <= HIGHEST_NOTE
+    ]
+    if not candidates:
+        return list(notes)
+    i = rng.choice(candidates)
+    number, duration = notes[i]
+    grace = [(number + 2, ORNAMENT_DURATION), (number, duration - ORNAMENT_DURATION)]
+    return notes[:i] + grace + notes[i + 1:]
+
+
+class VariationEngine:
+    """Produces new-sounding variations of cached melodies
+
+    Decides when a cached response may be reused with a variation and when
+    the upstream must be asked for a fresh one.
+    """
+
+    def __init__(self, upstream_ratio=0.2, max_reuses=20, transforms=2, rng=None):
+        """Initialize the engine
+
+        Args:
+            upstream_ratio (float): Fraction of cache hits still sent upstream for fresh material
+            max_reuses (int): Variations served from one cached response before it is refreshed
+            transforms (int): Transformations combined per variation
+            rng (random.Random): Random source, for reproducible runs
+        """
+        self.upstream_ratio = upstream_ratio
+        self.max_reuses = max_reuses
+        self.transforms = transforms
+        self.rng = rng or random.Random()
+
+    def should_call_upstream(self, reuses):
+        """Decide whether a cache hit still goes to the upstream
+
+        Args:
+            reuses (int): Variations already served from the cached response
+
+        Returns:
+            bool: True to generate a fresh response
+        """
+        return reuses >= self.max_reuses or self.rng.random() < self.upstream_ratio
+
+    def vary(self, notes, mood):
+        """Apply mood-preserving transformations to a parsed melody
+
+        Args:
+            notes (list): Parsed melody from parse_melody()
+            mood (str): Overall plant status ('good', 'needs_water', ...)
+
+        Returns:
+            list: Varied melody
+        """
+        allowed, (lowest_shift, highest_shift) = MOOD_PROFILES.get(mood, DEFAULT_PROFILE)
+        varied = notes
+        for name in self.rng.sample(allowed, min(self.transforms, len(allowed))):
+            if name == "transpose":
+                shift = self.rng.choice([s for s in range(lowest_shift, highest_shift + 1) if s != 0])
+                varied = transpose(varied, shift)
+            elif name == "inversion":
+                varied = invert(varied)
+            elif name == "retrograde":
+                varied = retrograde(varied)
+            elif name == "rhythm":
+                varied = permute_rhythm(varied, self.rng)
+            elif name == "ornament":
+                varied = ornament(varied, self.rng)
+        return varied
+
+    def vary_response(self, text, mood):
+        """Vary the melody of a full upstream response, keeping its message
+
+        Args:
+            text (str): Cached response ("MESSAGE: ...\\nMELODY: ...")
+            mood (str): Overall plant status
+
+        Returns:
+            str: Response with a varied melody, or the original if it cannot be parsed
+        """
+        message, melody_text = split_response(text)
+        try:
+            notes = parse_melody(melody_text, strict=False)
+        except ValueError:
+            return text
+        return format_response(message, format_melody(self.vary(notes, mood)))
@@ -0,0 +1 @@
+"""Host-side tools; run from the repository root as `python -m tools.<name>`"""
@@ -0,0 +1,146 @@
+"""Byte savings versus CPU cost of compressing realistic BioHarmony payloads
+
+    python -m tools.compression_bench
+    python -m tools.compression_bench --window-bits 9 10 12 15 --level 6 9 --json compression.json
+
+Compares deflate (zlib-wrapped, as HTTP means it) and gzip at several window
+sizes. Inflate time is the host's; on the ESP32 it is roughly two orders of
+magnitude slower, so compare ratios rather than absolute times.
+"""
+import argparse
+import json
+import random
+import time
+import zlib
+from server.compression import encode_body
+from server.upstream import MockUpstream
+
+SOILS = (15000, 21000, 23000, 27000, 31000)
+STATUSES = ("good", "needs_water", "too_wet", "dry_air", "humid_air", "temp_stress")
+
+
+def consulta_request(rng):
+    return {
+        "location": "Living Room",
+        "plant_type": "Monstera",
+        "soil_moisture": rng.choice(SOILS) + rng.randint(-300, 300),
+        "temperature": round(rng.uniform(16, 32), 1),
+        "humidity": round(rng.uniform(30, 85), 1),
+        "device_id": "%016x" % rng.getrandbits(64)
+    }
+
+
+def consulta_response(rng, mock):
+    return {"respuesta": mock.compose({"maxOutputTokens": 200, "temperature": 0.9})}
+
+
+def job_ticket(rng):
+    return {"ticket": "%032x" % rng.getrandbits(128), "status": "pending", "retry_after": 10}
+
+
+def telemetry_batch(rng, readings=60):
+    """A gateway uploading an hour of readings for one device"""
+    start = 1760000000 + rng.randint(0, 86400)
+    soil = rng.choice(SOILS)
+    return {
+        "device_id": "%016x" % rng.getrandbits(64),
+        "readings": [
+            {
+                "time": start + i * 60,
+                "soil_moisture": soil + i * 12 + rng.randint(-80, 80),
+                "temperature": round(22 + rng.uniform(-0.5, 0.5), 1),
+                "humidity": round(55 + rng.uniform(-2, 2), 1)
+            }
+            for i in range(readings)
+        ]
+    }
+
+
+def fleet_analyze_response(rng, devices=500):
+    return {
+        "overall_status": [rng.choice(STATUSES) for _ in range(devices)],
+        "counts": {status: rng.randint(0, devices) for status in STATUSES}
+    }
+
+
+def make_payloads(samples, seed):
+    """Serialized samples of each payload kind, as the server or device sends them"""
+    rng = random.Random(seed)
+    mock = MockUpstream(seed=seed)
+    kinds = {
+        "consulta_request": lambda: consulta_request(rng),
+        "consulta_response": lambda: consulta_response(rng, mock),
+        "job_ticket": lambda: job_ticket(rng),
+        "telemetry_batch": lambda: telemetry_batch(rng),
+        "fleet_analyze_response": lambda: fleet_analyze_response(rng)
+    }
+    return {
+        name: [json.dumps(make()).encode() for _ in range(samples)]
+        for name, make in kinds.items()
+    }
+
+
+def measure(bodies, encoding, window_bits, level):
+    """Compress and inflate every body once
+
+    Returns:
+        dict: Mean sizes and per-body timings
+    """
+    raw = sum(len(body) for body in bodies)
+    started = time.perf_counter()
+    compressed = [encode_body(body, encoding, window_bits, level) for body in bodies]
+    compress_s = time.perf_counter() - started
+
+    inflate_wbits = window_bits + 16 if encoding == "gzip" else window_bits
+    started = time.perf_counter()
+    for body in compressed:
+        zlib.decompress(body, inflate_wbits)
+    inflate_s = time.perf_counter() - started
+
+    packed = sum(len(body) for body in compressed)
+    return {
+        "encoding": encoding,
+        "window_bits": window_bits,
+        "level": level,
+        "mean_bytes": round(raw / len(bodies), 1),
+        "mean_compressed_bytes": round(packed / len(bodies), 1),
+        "ratio": round(packed / raw, 3),
+        "compress_us": round(compress_s / len(bodies) * 1e6, 2),
+        "inflate_us": round(inflate_s / len(bodies) * 1e6, 2)
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--samples", type=int, default=500, help="Bodies per payload kind")
+    parser.add_argument("--window-bits", type=int, nargs="+", default=[9, 10, 12, 15])
+    parser.add_argument("--level", type=int, nargs="+", default=[6])
+    parser.add_argument("--link-kbps", type=float, default=250.0, help="Effective radio throughput for airtime estimates")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--json", help="Write the results to this file")
+    args = parser.parse_args()
+
+    payloads = make_payloads(args.samples, args.seed)
+    results = []
+    print(f"{'payload':24} {'coding':8} {'wbits':>5} {'lvl':>3} {'bytes':>8} {'packed':>8} {'ratio':>6} "
+          f"{'comp us':>8} {'infl us':>8} {'air ms saved':>12}")
+    for name, bodies in payloads.items():
+        for encoding in ("deflate", "gzip"):
+            for window_bits in args.window_bits:
+                for level in args.level:
+                    result = measure(bodies, encoding, window_bits, level)
+                    saved = result["mean_bytes"] - result["mean_compressed_bytes"]
+                    result["payload"] = name
+                    result["airtime_saved_ms"] = round(saved * 8 / args.link_kbps, 3)
+                    results.append(result)
+                    print(f"{name:24} {encoding:8} {window_bits:>5} {level:>3} {result['mean_bytes']:>8} "
+                          f"{result['mean_compressed_bytes']:>8} {result['ratio']:>6} {result['compress_us']:>8} "
+                          f"{result['inflate_us']:>8} {result['airtime_saved_ms']:>12}")
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"link_kbps": args.link_kbps, "samples": args.samples, "results": results}, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,210 @@
+"""Simulate weeks of a PlantMonitor deployment on a virtual clock
+
+    python -m tools.deployment_sim --days 30
+    python -m tools.deployment_sim --days 30 --water-every 4 --outage 10:12 --json deployment.json
+    python -m tools.deployment_sim --days 30 --target-days 90
+
+Runs the unmodified monitoring loop on the host fakes with time.monotonic
+and time.sleep replaced by a virtual clock, so every interval in config.py
+(MAIN_LOOP_DELAY, AI_REQUEST_INTERVAL, the DHT11 read interval, melody
+durations) plays out in simulated time. The plant dries and is watered on a
+schedule, ambient readings follow a day/night cycle, and the server answers
+jobs after a modelled round trip except during optional outages; joining
+WiFi takes a modelled connect time. The energy manager's charge
+estimates are reported per component; --target-days gives it a battery
+lifetime to budget for, so its power levels can be seen adapting.
+"""
+import argparse
+import collections
+import contextlib
+import json
+import math
+import sys
+import time
+from tools import host
+from tools.host.clock import VirtualClock
+from tools.host.fakes import FakeResponse
+from tools.device_bench import NullWriter
+
+DAY = 86400.0
+WET_SOIL = 16000
+DRYING_PER_DAY = 3500
+# Modelled network timings, so the radio's on-time is charged
+ROUND_TRIP_SECONDS = 0.4
+WIFI_CONNECT_SECONDS = 2.5
+
+
+class Deployment:
+    """Plant, room and server behaviour over simulated days"""
+
+    def __init__(self, clock, water_every, outages):
+        self.clock = clock
+        self.water_every = water_every
+        self.outages = outages
+        self.tickets = 0
+
+    def update(self, env):
+        days = self.clock.now / DAY
+        since_watering = (days % self.water_every) if self.water_every else days
+        env.soil = min(40000, WET_SOIL + since_watering * DRYING_PER_DAY)
+        phase = math.sin(2 * math.pi * (days - 0.25))
+        env.temperature = 22.0 + 5.0 * phase
+        env.humidity = 55.0 - 15.0 * phase
+
+    def in_outage(self):
+        days = self.clock.now / DAY
+        return any(start <= days < end for start, end in self.outages)
+
+    def respond(self, method, url, body, headers):
+        """env.network hook: a healthy server, or timeouts during an outage"""
+        if self.in_outage():
+            # The device waits out its HTTP timeout before giving up
+            self.clock.sleep(30)
+            raise OSError(116, "ETIMEDOUT")
+        self.clock.sleep(ROUND_TRIP_SECONDS)
+        if "/profiles/" in url:
+            return FakeResponse(304, b"")
+        if method == "POST":
+            self.tickets += 1
+            return FakeResponse(202, json.dumps({"ticket": str(self.tickets), "retry_after": 5}).encode())
+        melody = "C4,0.25,E4,0.25,G4,0.5,E4,0.25,C5,0.75"
+        return FakeResponse(200, json.dumps({"respuesta": f"MESSAGE: Doing well\nMELODY: {melody}"}).encode())
+
+
+def count_calls(obj, prefix, counter):
+    """Wrap obj's methods starting with prefix so each call is counted"""
+    for name in dir(obj):
+        if name.startswith(prefix):
+            method = getattr(obj, name)
+
+            def counted(*args, _method=method, _name=name, **kwargs):
+                counter[_name] += 1
+                return _method(*args, **kwargs)
+
+            setattr(obj, name, counted)
+
+
+class CountingDHT:
+    """Proxy for the fake DHT11 counting actual sensor reads"""
+
+    def __init__(self, dht):
+        self.dht = dht
+        self.reads = 0
+
+    @property
+    def humidity(self):
+        self.reads += 1
+        return self.dht.humidity
+
+    @property
+    def temperature(self):
+        return self.dht.temperature
+
+
+def parse_outage(text):
+    start, _, end = text.partition(":")
+    return float(start), float(end)
+
+
+def simulate(days, water_every, outages, progress=False, target_days=None):
+    """Run the deployment
+
+    Returns:
+        dict: Counters for the whole run
+    """
+    code = host.install()
+    clock = VirtualClock()
+    deployment = Deployment(clock, water_every, outages)
+    env = host.activate(host.DeviceEnv())
+    env.clock = clock.monotonic
+    env.network = deployment.respond
+    env.wifi_connect_seconds = WIFI_CONNECT_SECONDS
+    
+    alerts = collections.Counter()
+    levels = collections.Counter()
+    displays = collections.Counter()
+    cycles = 0
+    started = time.perf_counter()
+    end = days * DAY
+    
+    with clock.installed(), contextlib.redirect_stdout(NullWriter()):
+        monitor = code.PlantMonitor()
+        monitor.energy.set_target_days(target_days)
+        dht = CountingDHT(monitor.ambient_sensor.dht)
+        monitor.ambient_sensor.dht = dht
+        count_calls(monitor.buzzer, "play_", alerts)
+        count_calls(monitor.display, "display_", displays)
+        
+        deployment.update(env)
+        monitor.startup_sequence()
+        monitor.is_running = True
+        next_report = DAY
+        while clock.now < end and monitor.is_running:
+            deployment.update(env)
+            monitor.read_and_display_status()
+            clock.sleep(monitor.loop_delay)
+            cycles += 1
+            levels[monitor.energy.level] += 1
+            if progress and clock.now >= next_report:
+                print(f"day {clock.now / DAY:.0f}: {cycles} cycles, {time.perf_counter() - started:.1f}s",
+                      file=sys.stderr)
+                next_report += DAY
+        energy = monitor.energy.get_energy_report()
+    
+    if env.buzzer_on_since is not None:
+        env.buzzer_on_seconds += clock.now - env.buzzer_on_since
+    
+    requests = collections.Counter()
+    failed = 0
+    for method, url, status, _ in env.requests:
+        endpoint = url.split("/", 3)[-1]
+        if endpoint.startswith("consulta/jobs/"):
+            endpoint = "consulta/jobs/{ticket}"
+        requests[f"{method} /{endpoint}"] += 1
+        failed += status == 0
+    
+    # play_ai_melody and play_comprehensive_alert call play_note/play_melody
+    # internally; count only the top-level alerts a person would hear
+    heard = {name: count for name, count in alerts.items() if name not in ("play_note", "play_melody")}
+    return {
+        "simulated_days": round(clock.now / DAY, 2),
+        "wall_seconds": round(time.perf_counter() - started, 1),
+        "cycles": cycles,
+        "ai_requests": dict(requests),
+        "ai_requests_failed": failed,
+        "alerts": heard,
+        "alerts_total": sum(heard.values()),
+        "display_writes": dict(displays),
+        "lcd_i2c_transactions": env.i2c_transactions,
+        "lcd_i2c_bytes": env.i2c_bytes,
+        "dht_reads": dht.reads,
+        "buzzer_on_seconds": round(env.buzzer_on_seconds, 1),
+        "buzzer_on_per_day_seconds": round(env.buzzer_on_seconds / max(days, 1e-9), 1),
+        "energy_mah": {name: round(mah, 1) for name, mah in energy["charge_mah"].items()},
+        "energy_average_ma": round(energy["average_ma"], 2),
+        "energy_budget_ma": energy["budget_ma"] and round(energy["budget_ma"], 2),
+        "energy_projected_days": energy["projected_days"] and round(energy["projected_days"], 1),
+        "energy_level_cycles": dict(sorted(levels.items()))
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--days", type=float, default=30.0)
+    parser.add_argument("--water-every", type=float, default=3.0, help="Days between waterings (0 = never)")
+    parser.add_argument("--outage", type=parse_outage, action="append", default=[],
+                        help="Server outage as START:END in days, e.g. 10:12 (repeatable)")
+    parser.add_argument("--target-days", type=float, help="Battery lifetime for the energy manager to budget for")
+    parser.add_argument("--json", help="Write the report to this file")
+    parser.add_argument("--progress", action="store_true", help="Print progress once per simulated day")
+    args = parser.parse_args()
+
+    report = simulate(args.days, args.water_every, args.outage, args.progress, args.target_days)
+    print(json.dumps(report, indent=2))
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,245 @@
+"""Microbenchmarks of the device's per-cycle code under CPython
+
+    python -m tools.device_bench --json device_bench.json
+    python -m tools.device_bench --check
+    python -m tools.device_bench --update-thresholds
+
+Runs the device modules on host fakes with time.sleep disabled. For each
+hot path it records time per call, peak and retained tracemalloc bytes per
+call and, for the LCD, I2C traffic on the counting fake bus. --check exits
+non-zero when a result exceeds tools/device_bench_thresholds.json or a
+thresholded case produced no result.
+
+CPython is far faster than an ESP32 running CircuitPython, so compare runs
+on the same host; allocation and bus figures carry over more directly.
+"""
+import argparse
+import contextlib
+import json
+import math
+import os
+import platform
+import statistics
+import sys
+import time
+import tracemalloc
+from tools import host
+from tools.host.clock import no_sleep
+
+THRESHOLDS_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "device_bench_thresholds.json")
+
+# Headroom given to measured values by --update-thresholds; time varies far more than allocations
+TIME_MARGIN = 3.0
+ALLOC_MARGIN = 1.5
+
+AI_RESPONSE = "MESSAGE: Feeling great today!\nMELODY: C4,0.5,E4,0.25,G4,0.25,C5,1.0,R,0.5,G4,0.5,E4,0.5,C4,1.0"
+AI_RESPONSE_UNLABELLED = "Here is a happy tune for you\nC4,0.5,E4,0.25,G4,0.25,C5,1.0,R,0.5,G4,0.5"
+MELODY = "C4,0.5,E4,0.25,G4,0.25,C5,1.0,R,0.5,G4,0.5,E4,0.5,C4,1.0,D4,0.5,F4,0.5,A4,0.5,x,bad"
+READINGS = ((22000, 55.0, 22.0), (28000, 45.0, 24.0), (18000, 80.0, 21.0), (23000, 30.0, 35.0))
+LCD_TEXT = "Soil: Normal 22k"
+
+
+class NullWriter:
+    """stdout replacement that drops device prints without buffering them"""
+
+    def write(self, text):
+        return len(text)
+
+    def flush(self):
+        pass
+
+
+def make_cases(env):
+    """Hot paths keyed by name, each a zero-argument callable"""
+    from utils.soil_analyzer import PlantAnalyzer
+    from alerts.buzzer_alerts import BuzzerAlerts
+    from display.lcd_display import LCDDisplay
+    from ai.melody_generator import AIPlantMelodyGenerator
+    
+    analyzer = PlantAnalyzer()
+    buzzer = BuzzerAlerts()
+    display = LCDDisplay()
+    generator = AIPlantMelodyGenerator()
+    statuses = [analyzer.get_comprehensive_status(*reading) for reading in READINGS]
+    counter = [0]
+    
+    def comprehensive_status():
+        counter[0] += 1
+        return analyzer.get_comprehensive_status(*READINGS[counter[0] % len(READINGS)])
+    
+    def plant_mood():
+        counter[0] += 1
+        return generator.generate_plant_mood(statuses[counter[0] % len(statuses)])
+    
+    def lcd_print():
+        display.lcd.set_cursor_pos(0, 0)
+        display.lcd.print(LCD_TEXT)
+    
+    return {
+        "parse_ai_response": lambda: generator.parse_ai_response(AI_RESPONSE),
+        "parse_ai_response_fallback": lambda: generator.parse_ai_response(AI_RESPONSE_UNLABELLED),
+        "play_ai_melody_parse": lambda: buzzer.play_ai_melody(MELODY),
+        "get_comprehensive_status": comprehensive_status,
+        "generate_plant_mood": plant_mood,
+        "lcd_print": lcd_print,
+        "display_comprehensive_status": lambda: display.display_comprehensive_status(statuses[1])
+    }
+
+
+def time_case(func, iterations, repeats):
+    """Nanoseconds per call: median and best of several timed batches"""
+    for _ in range(min(iterations, 100)):
+        func()
+    batches = []
+    for _ in range(repeats):
+        started = time.perf_counter_ns()
+        for _ in range(iterations):
+            func()
+        batches.append((time.perf_counter_ns() - started) / iterations)
+    return statistics.median(batches), min(batches)
+
+
+def allocations(func, calls):
+    """Peak transient and retained tracemalloc bytes per call
+
+    Returns:
+        tuple: (largest peak above the pre-call level, mean bytes still held after a call)
+    """
+    tracemalloc.start()
+    try:
+        func()
+        peak = 0
+        start_current, _ = tracemalloc.get_traced_memory()
+        for _ in range(calls):
+            before, _ = tracemalloc.get_traced_memory()
+            tracemalloc.reset_peak()
+            func()
+            _, call_peak = tracemalloc.get_traced_memory()
+            peak = max(peak, call_peak - before)
+        end_current, _ = tracemalloc.get_traced_memory()
+    finally:
+        tracemalloc.stop()
+    return peak, (end_current - start_current) / calls
+
+
+def bus_traffic(env, func, calls):
+    """I2C transactions and bytes per call on the counting fake bus"""
+    transactions, sent = env.i2c_transactions, env.i2c_bytes
+    for _ in range(calls):
+        func()
+    return (env.i2c_transactions - transactions) / calls, (env.i2c_bytes - sent) / calls
+
+
+def run(iterations, repeats, alloc_calls, only=None):
+    """Measure every case
+
+    Returns:
+        dict: Results keyed by case name
+    """
+    host.install()
+    env = host.activate(host.DeviceEnv())
+    results = {}
+    with contextlib.redirect_stdout(NullWriter()), no_sleep():
+        cases = make_cases(env)
+        for name, func in cases.items():
+            if only and name not in only:
+                continue
+            median_ns, best_ns = time_case(func, iterations, repeats)
+            peak, retained = allocations(func, alloc_calls)
+            transactions, sent = bus_traffic(env, func, alloc_calls)
+            results[name] = {
+                "ns_per_call": round(median_ns),
+                "best_ns_per_call": round(best_ns),
+                "peak_alloc_bytes": peak,
+                "retained_bytes_per_call": round(retained, 2),
+                "i2c_transactions_per_call": transactions,
+                "i2c_bytes_per_call": sent
+            }
+    return results
+
+
+def check(results, thresholds, only=None):
+    """Compare results with thresholds
+
+    Args:
+        results (dict): Results by case
+        thresholds (dict): Limits by case
+        only (list): Cases selected with --only; other thresholded cases are not expected
+
+    Returns:
+        list: Descriptions of every breached threshold and missing case
+    """
+    failures = []
+    for name, limits in thresholds.items():
+        if name not in results:
+            if only is None or name in only:
+                failures.append(f"{name}: no result (case renamed or removed?)")
+            continue
+        for metric, limit in limits.items():
+            value = results[name][metric.replace("max_", "", 1)]
+            if value > limit:
+                failures.append(f"{name}: {metric.replace('max_', '', 1)} {value} > {limit}")
+    return failures
+
+
+def make_thresholds(results):
+    """Thresholds from a run, with headroom for noise"""
+    return {
+        name: {
+            "max_ns_per_call": int(round(result["ns_per_call"] * TIME_MARGIN, -2)),
+            "max_peak_alloc_bytes": int(result["peak_alloc_bytes"] * ALLOC_MARGIN) + 64,
+            "max_retained_bytes_per_call": 1.0,
+            "max_i2c_transactions_per_call": math.ceil(result["i2c_transactions_per_call"]),
+            "max_i2c_bytes_per_call": math.ceil(result["i2c_bytes_per_call"])
+        }
+        for name, result in results.items()
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--iterations", type=int, default=2000, help="Calls per timed batch")
+    parser.add_argument("--repeats", type=int, default=7, help="Timed batches per case")
+    parser.add_argument("--alloc-calls", type=int, default=200, help="Calls traced for allocations")
+    parser.add_argument("--only", nargs="+", help="Run only these cases")
+    parser.add_argument("--json", help="Write results to this file")
+    parser.add_argument("--thresholds", default=THRESHOLDS_PATH)
+    parser.add_argument("--check", action="store_true", help="Exit 1 if a threshold is exceeded")
+    parser.add_argument("--update-thresholds", action="store_true", help="Rewrite thresholds from this run")
+    args = parser.parse_args()
+
+    results = run(args.iterations, args.repeats, args.alloc_calls, args.only)
+    report = {
+        "python": platform.python_version(),
+        "implementation": platform.python_implementation(),
+        "machine": platform.machine(),
+        "results": results
+    }
+    
+    print(f"{'case':30} {'ns/call':>10} {'peak B':>8} {'kept B':>8} {'i2c tx':>7} {'i2c B':>7}")
+    for name, result in results.items():
+        print(f"{name:30} {result['ns_per_call']:>10} {result['peak_alloc_bytes']:>8} "
+              f"{result['retained_bytes_per_call']:>8} {result['i2c_transactions_per_call']:>7g} "
+              f"{result['i2c_bytes_per_call']:>7g}")
+    
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=2)
+    
+    if args.update_thresholds:
+        with open(args.thresholds, "w") as f:
+            json.dump(make_thresholds(results), f, indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"Thresholds written to {args.thresholds}")
+    elif args.check:
+        with open(args.thresholds) as f:
+            failures = check(results, json.load(f), args.only)
+        for failure in failures:
+            print(f"REGRESSION {failure}")
+        if failures:
+            sys.exit(1)
+        print("All device benchmarks within thresholds")
+
+
+if __name__ == "__main__":
+    main()
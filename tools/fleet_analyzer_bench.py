@@ -0,0 +1,90 @@
+"""Parity check and benchmark of FleetAnalyzer against PlantAnalyzer
+
+    python -m tools.fleet_analyzer_bench --parity 200000 --readings 1000000 5000000
+"""
+import argparse
+import sys
+import time
+import numpy as np
+from config import SOIL_HUMIDITY_THRESHOLDS, AMBIENT_THRESHOLDS
+from utils.soil_analyzer import PlantAnalyzer
+from server.fleet_analyzer import FleetAnalyzer
+
+
+def make_readings(count, rng):
+    """Random readings with a share of values exactly on each threshold"""
+    soil = rng.uniform(10000, 40000, count)
+    humidity = rng.uniform(10, 95, count)
+    temperature = rng.uniform(-5, 45, count)
+    
+    edges = count // 10
+    soil[:edges] = rng.choice([SOIL_HUMIDITY_THRESHOLDS['dry'], SOIL_HUMIDITY_THRESHOLDS['normal']], edges)
+    humidity[:edges] = rng.choice(list(AMBIENT_THRESHOLDS['humidity'].values()), edges)
+    temperature[:edges] = rng.choice(list(AMBIENT_THRESHOLDS['temperature'].values()), edges)
+    return soil, humidity, temperature
+
+
+def check_parity(count, rng):
+    """Compare every reading against PlantAnalyzer
+
+    Returns:
+        int: Number of mismatching readings
+    """
+    soil, humidity, temperature = make_readings(count, rng)
+    result = FleetAnalyzer().analyze(soil, humidity, temperature)
+    scalar = PlantAnalyzer()
+    
+    mismatches = 0
+    for i in range(count):
+        expected = scalar.get_comprehensive_status(float(soil[i]), float(humidity[i]), float(temperature[i]))
+        actual = FleetAnalyzer.decode(result, i)
+        if (actual['soil_status'] != expected['soil_status']
+                or actual['humidity_status'] != expected['ambient_conditions']['humidity_status']
+                or actual['temperature_status'] != expected['ambient_conditions']['temperature_status']
+                or actual['overall_status'] != expected['overall_status']
+                or actual['priority_action'] != expected['priority_action']):
+            mismatches += 1
+            if mismatches <= 5:
+                print(f"Mismatch at {soil[i]}, {humidity[i]}, {temperature[i]}: {actual} != {expected}")
+    return mismatches
+
+
+def benchmark(count, rng, scalar_sample=100000):
+    """Time the array analyzer and the scalar analyzer per reading"""
+    soil, humidity, temperature = make_readings(count, rng)
+    analyzer = FleetAnalyzer()
+    
+    started = time.perf_counter()
+    result = analyzer.analyze(soil, humidity, temperature)
+    vector_seconds = time.perf_counter() - started
+    
+    scalar = PlantAnalyzer()
+    sample = min(count, scalar_sample)
+    started = time.perf_counter()
+    for i in range(sample):
+        scalar.get_comprehensive_status(soil[i], humidity[i], temperature[i])
+    scalar_seconds = (time.perf_counter() - started) * count / sample
+    
+    print(f"{count:>10,} readings: vectorized {vector_seconds * 1000:8.1f} ms "
+          f"({count / vector_seconds / 1e6:6.1f} M/s), scalar ~{scalar_seconds:7.2f} s, "
+          f"speedup {scalar_seconds / vector_seconds:5.0f}x")
+    print(f"{'':>10}  {analyzer.counts(result)}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--parity", type=int, default=100000, help="Readings checked against PlantAnalyzer")
+    parser.add_argument("--readings", type=int, nargs="*", default=[1000000, 5000000], help="Benchmark sizes")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+    rng = np.random.default_rng(args.seed)
+
+    mismatches = check_parity(args.parity, rng)
+    print(f"Parity: {args.parity - mismatches}/{args.parity} readings match PlantAnalyzer")
+    for count in args.readings:
+        benchmark(count, rng)
+    sys.exit(1 if mismatches else 0)
+
+
+if __name__ == "__main__":
+    main()
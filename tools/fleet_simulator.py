@@ -0,0 +1,207 @@
+"""Run many simulated boards with the real PlantMonitor code against a server
+
+    python -m tools.fleet_simulator --devices 1000 --duration 300 --spawn-server
+    python -m tools.fleet_simulator --devices 200 --server http://staging:8000 --scenarios drying,flaky_dht
+
+Each device is a thread running code.py's PlantMonitor on host fakes; the
+fake adafruit_requests session talks to the server over normal sockets.
+"""
+import argparse
+import contextlib
+import io
+import json
+import math
+import os
+import random
+import subprocess
+import sys
+import threading
+import time
+import urllib.request
+from collections import Counter
+from tools import host
+from tools.replay_traffic import percentile
+
+
+# --- Plant scenarios: update(env, elapsed_seconds, rng) ----------------------
+
+def healthy(env, elapsed, rng):
+    env.soil = 23000 + rng.randint(-150, 150)
+    env.temperature = 22.0 + math.sin(elapsed / 600.0)
+    env.humidity = 55.0 + rng.uniform(-2, 2)
+
+
+def drying(env, elapsed, rng):
+    # Crosses the dry threshold after about ten minutes
+    env.soil = 21000 + elapsed * 8 + rng.randint(-150, 150)
+    env.temperature = 24.0
+    env.humidity = 50.0 + rng.uniform(-2, 2)
+
+
+def watering_cycle(env, elapsed, rng):
+    # Dries for five minutes, then gets watered
+    env.soil = 17000 + (elapsed % 300) * 35 + rng.randint(-150, 150)
+    env.temperature = 22.0
+    env.humidity = 60.0
+
+
+def overwatered(env, elapsed, rng):
+    env.soil = 15000 + rng.randint(-150, 150)
+    env.temperature = 21.0
+    env.humidity = 80.0 + rng.uniform(-3, 3)
+
+
+def heatwave(env, elapsed, rng):
+    env.soil = 24000 + elapsed * 3
+    env.temperature = min(45.0, 26.0 + elapsed / 30.0)
+    env.humidity = max(20.0, 50.0 - elapsed / 20.0)
+
+
+def flaky_dht(env, elapsed, rng):
+    healthy(env, elapsed, rng)
+    env.dht_error = RuntimeError("Checksum did not validate") if rng.random() < 0.3 else None
+
+
+SCENARIOS = {
+    "healthy": healthy,
+    "drying": drying,
+    "watering_cycle": watering_cycle,
+    "overwatered": overwatered,
+    "heatwave": heatwave,
+    "flaky_dht": flaky_dht,
+}
+
+
+def run_device(code, env, scenario, deadline, loop_delay, start_delay, seed, errors):
+    """Thread body: one board running startup and the monitoring loop"""
+    host.activate(env)
+    rng = random.Random(seed)
+    time.sleep(start_delay)
+    try:
+        monitor = code.PlantMonitor()
+        started = time.monotonic()
+        scenario(env, 0.0, rng)
+        monitor.startup_sequence()
+        while time.monotonic() < deadline:
+            scenario(env, time.monotonic() - started, rng)
+            monitor.read_and_display_status()
+            # As in PlantMonitor.run: console output between cycles
+            code.log.flush()
+            time.sleep(loop_delay)
+    except Exception as e:
+        errors.append(f"{type(e).__name__}: {e}")
+
+
+def spawn_server(port):
+    """Start main.py under uvicorn with the mock upstream and wait until it is ready"""
+    server_env = dict(os.environ, UPSTREAM_MODE="mock")
+    process = subprocess.Popen(
+        [sys.executable, "-m", "uvicorn", "main:app", "--port", str(port), "--log-level", "warning"],
+        env=server_env
+    )
+    url = f"http://127.0.0.1:{port}"
+    for _ in range(100):
+        try:
+            with urllib.request.urlopen(url + "/ready", timeout=1) as response:
+                if response.status == 200:
+                    return process, url
+        except OSError:
+            pass
+        time.sleep(0.2)
+    process.terminate()
+    raise RuntimeError("Server did not become ready")
+
+
+def fetch_json(url):
+    try:
+        with urllib.request.urlopen(url, timeout=5) as response:
+            return json.loads(response.read())
+    except (OSError, ValueError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--devices", type=int, default=100, help="Simulated boards")
+    parser.add_argument("--duration", type=float, default=120.0, help="Seconds to run")
+    parser.add_argument("--server", default="http://127.0.0.1:8000", help="Server base URL")
+    parser.add_argument("--spawn-server", action="store_true", help="Start main.py with the mock upstream")
+    parser.add_argument("--port", type=int, default=8765, help="Port for --spawn-server")
+    parser.add_argument("--scenarios", default=",".join(SCENARIOS), help="Comma-separated scenario mix")
+    parser.add_argument("--loop-delay", type=float, help="Override MAIN_LOOP_DELAY")
+    parser.add_argument("--ai-interval", type=float, help="Override AI_REQUEST_INTERVAL")
+    parser.add_argument("--ramp", type=float, help="Seconds over which devices start (default one loop)")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--verbose", action="store_true", help="Show device console output")
+    args = parser.parse_args()
+
+    names = args.scenarios.split(",")
+    unknown = [name for name in names if name not in SCENARIOS]
+    if unknown:
+        parser.error(f"unknown scenarios: {', '.join(unknown)}")
+
+    code = host.install()
+    import ai.melody_generator
+    if args.ai_interval is not None:
+        ai.melody_generator.AI_REQUEST_INTERVAL = args.ai_interval
+    loop_delay = args.loop_delay if args.loop_delay is not None else code.MAIN_LOOP_DELAY
+    ramp = args.ramp if args.ramp is not None else loop_delay
+
+    server = None
+    url = args.server
+    if args.spawn_server:
+        server, url = spawn_server(args.port)
+
+    # Many device threads: keep their stacks small
+    threading.stack_size(512 * 1024)
+    rng = random.Random(args.seed)
+    deadline = time.monotonic() + args.duration
+    envs = []
+    threads = []
+    errors = []
+    for n in range(args.devices):
+        env = host.DeviceEnv(uid=n.to_bytes(8, "big"), server_url=url)
+        scenario = SCENARIOS[names[n % len(names)]]
+        thread = threading.Thread(
+            target=run_device,
+            args=(code, env, scenario, deadline, loop_delay, rng.uniform(0, ramp), rng.random(), errors),
+            daemon=True
+        )
+        envs.append(env)
+        threads.append(thread)
+
+    print(f"Running {args.devices} devices for {args.duration:g}s against {url}", file=sys.stderr)
+    output = contextlib.nullcontext() if args.verbose else contextlib.redirect_stdout(io.StringIO())
+    try:
+        with output:
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join(timeout=max(0.0, deadline - time.monotonic()) + 120)
+    finally:
+        metrics = fetch_json(url + "/admission")
+        if server is not None:
+            server.terminate()
+
+    requests = [record for env in envs for record in env.requests]
+    latencies = [latency for _, _, status, latency in requests if status]
+    report = {
+        "devices": args.devices,
+        "duration_s": args.duration,
+        "requests": len(requests),
+        "requests_per_s": round(len(requests) / args.duration, 2),
+        "status": dict(Counter(str(status) for _, _, status, _ in requests)),
+        "device_latency_ms": {
+            "p50": round(percentile(latencies, 0.50) * 1000, 1),
+            "p90": round(percentile(latencies, 0.90) * 1000, 1),
+            "p99": round(percentile(latencies, 0.99) * 1000, 1),
+            "max": round(max(latencies, default=0.0) * 1000, 1)
+        },
+        "device_errors": dict(Counter(errors)),
+        "server_admission": metrics
+    }
+    print(json.dumps(report, indent=2))
+
+
+if __name__ == "__main__":
+    main()
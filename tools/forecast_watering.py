@@ -0,0 +1,182 @@
+"""Forecast when each plant's soil crosses the dry threshold and emit a watering schedule
+
+    python -m tools.forecast_watering history.csv --horizon-hours 24 --output schedule.csv
+    python -m tools.forecast_watering --generate 5000 --workers 8
+
+History CSV columns: plant_id, timestamp (epoch seconds), soil_value (raw, higher is drier).
+"""
+import argparse
+import csv
+import os
+import random
+import sys
+import time
+from collections import defaultdict
+from concurrent.futures import ProcessPoolExecutor
+from config import SOIL_HUMIDITY_THRESHOLDS
+from server.device_context import WATERING_DROP
+
+# Fewer readings than this since the last watering are not enough for a fit
+MIN_FIT_READINGS = 3
+
+
+def fit_drying_curve(times, values):
+    """Least-squares line through the readings since the last watering
+
+    Args:
+        times (list): Reading times in epoch seconds, ascending
+        values (list): Raw soil readings
+
+    Returns:
+        tuple: (intercept, slope per second, readings used) or None if too few readings
+    """
+    start = 0
+    for i in range(1, len(values)):
+        if values[i] - values[i - 1] <= -WATERING_DROP:
+            start = i
+    times, values = times[start:], values[start:]
+    count = len(times)
+    if count < MIN_FIT_READINGS:
+        return None
+    
+    # Centre the times so the sums stay well conditioned
+    origin = times[0]
+    mean_t = sum(t - origin for t in times) / count
+    mean_v = sum(values) / count
+    covariance = variance = 0.0
+    for t, v in zip(times, values):
+        dt = t - origin - mean_t
+        covariance += dt * (v - mean_v)
+        variance += dt * dt
+    if variance == 0:
+        return None
+    slope = covariance / variance
+    return mean_v - slope * (origin + mean_t), slope, count
+
+
+def forecast_plant(plant_id, times, values, threshold, now):
+    """Predict when one plant reaches the dry threshold
+
+    Returns:
+        dict: Forecast row, with due_time None if the soil is not drying
+    """
+    fit = fit_drying_curve(times, values)
+    last_value = values[-1]
+    if last_value > threshold:
+        due_time = now
+    elif fit is None or fit[1] <= 0:
+        due_time = None
+    else:
+        intercept, slope, _ = fit
+        due_time = max(now, (threshold - intercept) / slope)
+    return {
+        "plant_id": plant_id,
+        "due_time": due_time,
+        "last_value": last_value,
+        "drying_per_hour": round(fit[1] * 3600, 1) if fit else None,
+        "readings_fitted": fit[2] if fit else 0
+    }
+
+
+def forecast_chunk(chunk, threshold, now):
+    """Forecast a chunk of plants (runs in a worker process)"""
+    return [forecast_plant(plant_id, times, values, threshold, now) for plant_id, times, values in chunk]
+
+
+def load_history(path):
+    """Group a history CSV by plant, sorted by time
+
+    Returns:
+        list: (plant_id, times, values) per plant
+    """
+    readings = defaultdict(list)
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            readings[row["plant_id"]].append((float(row["timestamp"]), float(row["soil_value"])))
+    plants = []
+    for plant_id, rows in readings.items():
+        rows.sort()
+        plants.append((plant_id, [t for t, _ in rows], [v for _, v in rows]))
+    return plants
+
+
+def generate_history(count, now, seed, readings=96, interval=900):
+    """Synthetic drying histories: each plant dries at its own rate after a random watering
+
+    Returns:
+        list: (plant_id, times, values) per plant
+    """
+    rng = random.Random(seed)
+    plants = []
+    for n in range(count):
+        rate = rng.uniform(50, 600) / 3600  # Raw units per second
+        value = rng.uniform(15000, 22000)
+        watered_at = rng.randrange(readings)
+        times, values = [], []
+        for i in range(readings):
+            if i == watered_at:
+                value = rng.uniform(14000, 17000)
+            value += rate * interval + rng.gauss(0, 60)
+            times.append(now - (readings - i) * interval)
+            values.append(value)
+        plants.append((f"plant-{n:05d}", times, values))
+    return plants
+
+
+def forecast_all(plants, threshold, now, workers):
+    """Forecast every plant across a process pool
+
+    Returns:
+        list: Forecast rows
+    """
+    # A few chunks per worker keeps the pool balanced without per-plant pickling overhead
+    chunk_size = max(1, len(plants) // (workers * 4))
+    chunks = [plants[i:i + chunk_size] for i in range(0, len(plants), chunk_size)]
+    rows = []
+    with ProcessPoolExecutor(max_workers=workers) as pool:
+        for result in pool.map(forecast_chunk, chunks, [threshold] * len(chunks), [now] * len(chunks)):
+            rows.extend(result)
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("history", nargs="?", help="History CSV (plant_id,timestamp,soil_value)")
+    parser.add_argument("--generate", type=int, help="Use N synthetic plants instead of a CSV")
+    parser.add_argument("--threshold", type=float, default=SOIL_HUMIDITY_THRESHOLDS['dry'], help="Dry threshold")
+    parser.add_argument("--horizon-hours", type=float, default=24.0, help="Schedule plants due within this window")
+    parser.add_argument("--now", type=float, help="Forecast start time (epoch seconds), default now")
+    parser.add_argument("--workers", type=int, default=os.cpu_count(), help="Worker processes")
+    parser.add_argument("--output", help="Write the schedule CSV here instead of stdout")
+    args = parser.parse_args()
+    if not args.history and not args.generate:
+        parser.error("give a history CSV or --generate N")
+
+    now = args.now or time.time()
+    started = time.perf_counter()
+    plants = generate_history(args.generate, now, seed=1) if args.generate else load_history(args.history)
+    loaded = time.perf_counter()
+    rows = forecast_all(plants, args.threshold, now, args.workers)
+    finished = time.perf_counter()
+
+    horizon = now + args.horizon_hours * 3600
+    schedule = sorted((row for row in rows if row["due_time"] is not None and row["due_time"] <= horizon),
+                      key=lambda row: row["due_time"])
+
+    out = open(args.output, "w", newline="") if args.output else sys.stdout
+    writer = csv.writer(out)
+    writer.writerow(["due_time", "due_in_hours", "plant_id", "last_value", "drying_per_hour"])
+    for row in schedule:
+        writer.writerow([time.strftime("%Y-%m-%d %H:%M", time.localtime(row["due_time"])),
+                         round((row["due_time"] - now) / 3600, 2), row["plant_id"],
+                         round(row["last_value"]), row["drying_per_hour"]])
+    if args.output:
+        out.close()
+
+    print(f"{len(plants)} plants, {len(schedule)} due within {args.horizon_hours:g}h; "
+          f"load {loaded - started:.2f}s, forecast {finished - loaded:.2f}s on {args.workers} workers",
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,59 @@
+"""Run the device code on a Linux host with fake CircuitPython modules
+
+    from tools import host
+    code = host.install()
+    env = host.activate(host.DeviceEnv(soil=27000))
+    monitor = code.PlantMonitor()
+"""
+import importlib.util
+import os
+import sys
+from tools.host.device import DeviceEnv, DeviceLog, activate, current
+from tools.host.fakes import install_modules
+
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+_code_module = None
+
+
+def _prepare_lcd_package():
+    # lib/lcd has no __init__.py on the board; i2c_pcf8574_interface imports the
+    # constants from the package, so expose lcd.lcd's names on it
+    import lcd
+    import lcd.lcd as lcd_module
+    for name in dir(lcd_module):
+        if not name.startswith("__"):
+            setattr(lcd, name, getattr(lcd_module, name))
+
+
+def install():
+    """Install fakes and import code.py
+
+    Returns:
+        module: The device's code.py, imported as "bioharmony_code"
+    """
+    global _code_module
+    if _code_module is not None:
+        return _code_module
+    
+    for path in (os.path.join(REPO_ROOT, "lib"), REPO_ROOT):
+        if path not in sys.path:
+            sys.path.insert(0, path)
+    install_modules()
+    _prepare_lcd_package()
+    
+    # Simulated boards share the host filesystem; keep their profiles and logs in memory, with no melody pack
+    import config
+    config.PLANT_PROFILE_PATH = None
+    config.MELODY_PACK_PATH = None
+    config.LOG_PERSIST_PATH = None
+    
+    # Each board logs into its own DeviceEnv
+    import utils.logger
+    utils.logger.log = DeviceLog()
+    
+    spec = importlib.util.spec_from_file_location("bioharmony_code", os.path.join(REPO_ROOT, "code.py"))
+    _code_module = importlib.util.module_from_spec(spec)
+    sys.modules["bioharmony_code"] = _code_module
+    spec.loader.exec_module(_code_module)
+    return _code_module
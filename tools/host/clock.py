@@ -0,0 +1,76 @@
+"""Clock shims for host runs of the device code"""
+import contextlib
+import heapq
+import time
+
+
+@contextlib.contextmanager
+def no_sleep():
+    """Make time.sleep return immediately
+
+    The device modules call time.sleep directly for melody notes, LCD
+    command delays and sensor settling. Without those waits, a timed call
+    measures only the code's own work.
+    """
+    original = time.sleep
+    time.sleep = lambda seconds: None
+    try:
+        yield
+    finally:
+        time.sleep = original
+
+
+class VirtualClock:
+    """Simulated time for time.monotonic and time.sleep
+
+    sleep() advances the clock instantly, so a run covers days of device
+    time in seconds. Code that busy-waits on time.monotonic without
+    sleeping needs a non-zero tick to make progress. Callbacks registered
+    with at() run when the clock passes their time, including in the middle
+    of a sleep, so events can land while a melody note or request is waiting.
+
+    Args:
+        start (float): Initial monotonic time in seconds
+        tick (float): Seconds added by every monotonic() call
+    """
+
+    def __init__(self, start=0.0, tick=0.0):
+        self.now = start
+        self.tick = tick
+        self.slept = 0.0
+        self.events = []
+        self.event_count = 0
+
+    def at(self, when, callback):
+        """Call callback() once the clock reaches when"""
+        self.event_count += 1
+        heapq.heappush(self.events, (when, self.event_count, callback))
+
+    def advance(self, seconds):
+        """Move the clock forward, running due callbacks at their own times"""
+        target = self.now + seconds
+        while self.events and self.events[0][0] <= target:
+            when, _, callback = heapq.heappop(self.events)
+            self.now = max(self.now, when)
+            callback()
+        self.now = target
+
+    def monotonic(self):
+        if self.tick:
+            self.advance(self.tick)
+        return self.now
+
+    def sleep(self, seconds):
+        if seconds > 0:
+            self.advance(seconds)
+            self.slept += seconds
+
+    @contextlib.contextmanager
+    def installed(self):
+        """Replace time.monotonic and time.sleep for the duration of the block"""
+        original = time.monotonic, time.sleep
+        time.monotonic, time.sleep = self.monotonic, self.sleep
+        try:
+            yield self
+        finally:
+            time.monotonic, time.sleep = original
@@ -0,0 +1,91 @@
+import threading
+import time
+
+
+class DeviceEnv:
+    """Simulated hardware and network state of one board
+
+    Host fakes look up the environment of the thread that creates them, so
+    several PlantMonitor instances can run side by side in one process.
+    """
+
+    def __init__(self, uid=b"\x00" * 8, soil=22000, humidity=55.0, temperature=22.0,
+                 server_url="http://127.0.0.1:8000", http_timeout=30.0):
+        """Initialize the environment
+
+        Args:
+            uid (bytes): Value of microcontroller.cpu.uid
+            soil (int): Raw soil sensor reading
+            humidity (float): DHT11 humidity
+            temperature (float): DHT11 temperature
+            server_url (str): secrets["url_mcp"]
+            http_timeout (float): Timeout of bridged HTTP requests
+        """
+        self.uid = uid
+        self.soil = soil
+        self.humidity = humidity
+        self.temperature = temperature
+        self.server_url = server_url
+        self.http_timeout = http_timeout
+        
+        # Scripted faults
+        self.dht_error = None      # Exception raised by DHT11 reads when set
+        self.wifi_error = None     # Exception raised by wifi.radio.connect when set
+        self.wifi_enabled = True   # wifi.radio.enabled
+        self.wifi_connect_seconds = 0.0  # Time wifi.radio.connect takes, slept on time.sleep
+        
+        # Replaces the real HTTP bridge when set: network(method, url, body, headers) -> FakeResponse
+        self.network = None
+        
+        # I2C traffic: one transaction per `with i2c_device:` block
+        self.i2c_transactions = 0
+        self.i2c_bytes = 0
+        self.i2c_log = None        # Set to a list to record (transaction, bytes) writes
+        self.i2c_listener = None   # Called as i2c_listener(address, bytes) on every write when set
+        
+        # Buzzer: (time, frequency, duty_cycle) on every PWM change when set to a list
+        self.buzzer_log = None
+        self.buzzer_on_seconds = 0.0
+        self.buzzer_on_since = None
+        
+        # HTTP requests made by the device: (method, url, status, latency seconds)
+        self.requests = []
+        
+        # Clock used to timestamp events; replaced by virtual clocks
+        self.clock = time.monotonic
+        
+        self._log = None
+    
+    @property
+    def log(self):
+        """This board's Logger, created on first use after host.install() configured logging"""
+        if self._log is None:
+            from utils.logger import Logger
+            self._log = Logger()
+        return self._log
+
+
+class DeviceLog:
+    """Stand-in for utils.logger.log that writes to the calling thread's DeviceEnv.log
+
+    The device modules share one module-level logger; boards running side by
+    side in threads each get their own buffer instead of racing on one.
+    """
+
+    def __getattr__(self, name):
+        return getattr(current().log, name)
+
+
+_local = threading.local()
+_default = DeviceEnv()
+
+
+def current():
+    """Environment of the calling thread (a shared default if none was activated)"""
+    return getattr(_local, "env", None) or _default
+
+
+def activate(env):
+    """Make env the environment of the calling thread"""
+    _local.env = env
+    return env
@@ -0,0 +1,285 @@
+import http.client
+import json
+import sys
+import time
+import types
+import urllib.parse
+from tools.host.device import current
+
+
+# --- board, analogio, adafruit_dht, pwmio -----------------------------------
+
+class FakeI2C:
+    """Stand-in for busio.I2C / board.I2C()"""
+
+    def __init__(self, *args, **kwargs):
+        self.env = current()
+
+    def deinit(self):
+        pass
+
+
+class FakeAnalogIn:
+    """analogio.AnalogIn reading the soil value of its device"""
+
+    def __init__(self, pin):
+        self.env = current()
+
+    @property
+    def value(self):
+        return int(self.env.soil)
+
+
+class FakeDHT11:
+    """adafruit_dht.DHT11 reading the ambient values of its device"""
+
+    def __init__(self, pin):
+        self.env = current()
+
+    @property
+    def humidity(self):
+        if self.env.dht_error is not None:
+            raise self.env.dht_error
+        return self.env.humidity
+
+    @property
+    def temperature(self):
+        if self.env.dht_error is not None:
+            raise self.env.dht_error
+        return self.env.temperature
+
+
+class FakePWMOut:
+    """pwmio.PWMOut that logs frequency and duty cycle changes"""
+
+    def __init__(self, pin, duty_cycle=0, frequency=440, variable_frequency=False):
+        self.env = current()
+        self._duty_cycle = duty_cycle
+        self._frequency = frequency
+
+    def _log(self):
+        if self.env.buzzer_log is not None:
+            self.env.buzzer_log.append((self.env.clock(), self._frequency, self._duty_cycle))
+
+    @property
+    def duty_cycle(self):
+        return self._duty_cycle
+
+    @duty_cycle.setter
+    def duty_cycle(self, value):
+        env = self.env
+        if value and env.buzzer_on_since is None:
+            env.buzzer_on_since = env.clock()
+        elif not value and env.buzzer_on_since is not None:
+            env.buzzer_on_seconds += env.clock() - env.buzzer_on_since
+            env.buzzer_on_since = None
+        self._duty_cycle = value
+        self._log()
+
+    @property
+    def frequency(self):
+        return self._frequency
+
+    @frequency.setter
+    def frequency(self, value):
+        self._frequency = value
+
+    def deinit(self):
+        pass
+
+
+# --- adafruit_bus_device -----------------------------------------------------
+
+class FakeI2CDevice:
+    """adafruit_bus_device.i2c_device.I2CDevice counting bus traffic"""
+
+    def __init__(self, i2c, address, probe=True):
+        self.env = current()
+        self.address = address
+
+    def __enter__(self):
+        self.env.i2c_transactions += 1
+        return self
+
+    def __exit__(self, *exc):
+        return False
+
+    def write(self, buffer, start=0, end=None):
+        # Hot path of every LCD update: count without copying unless logging
+        env = self.env
+        if end is None:
+            end = len(buffer)
+        env.i2c_bytes += end - start
+        if env.i2c_log is not None:
+            env.i2c_log.append((env.i2c_transactions, bytes(buffer[start:end])))
+        if env.i2c_listener is not None:
+            env.i2c_listener(self.address, bytes(buffer[start:end]))
+
+
+# --- microcontroller, micropython --------------------------------------------
+
+class _FakeCpu:
+    @property
+    def uid(self):
+        return current().uid
+
+
+# --- wifi, socketpool, adafruit_requests ------------------------------------
+
+class _FakeRadio:
+    ipv4_address = "127.0.0.1"
+
+    @property
+    def enabled(self):
+        return current().wifi_enabled
+
+    @enabled.setter
+    def enabled(self, value):
+        current().wifi_enabled = bool(value)
+
+    def connect(self, ssid, password):
+        env = current()
+        if not env.wifi_enabled:
+            raise ConnectionError("WiFi is not enabled")
+        if env.wifi_connect_seconds:
+            time.sleep(env.wifi_connect_seconds)
+        if env.wifi_error is not None:
+            raise env.wifi_error
+
+
+class FakeSocketPool:
+    def __init__(self, radio):
+        pass
+
+
+class FakeResponse:
+    """adafruit_requests.Response lookalike"""
+
+    def __init__(self, status_code, content=b"", headers=None):
+        self.status_code = status_code
+        self.content = content
+        # adafruit_requests reports header names in lower case
+        self.headers = {name.lower(): value for name, value in (headers or {}).items()}
+
+    @property
+    def text(self):
+        return self.content.decode("utf-8", "replace")
+
+    def json(self):
+        return json.loads(self.content)
+
+    def close(self):
+        pass
+
+
+class FakeSession:
+    """adafruit_requests.Session bridged to host sockets
+
+    Keeps one keep-alive connection per session, like the real library, and
+    records every request in the device environment.
+    """
+
+    def __init__(self, pool=None, ssl_context=None):
+        self.env = current()
+        self._connection = None
+        self._netloc = None
+
+    def request(self, method, url, data=None, json=None, headers=None, timeout=None):
+        env = self.env
+        body = data
+        headers = dict(headers or {})
+        if json is not None:
+            body = _json_dumps(json).encode()
+            headers.setdefault("Content-Type", "application/json")
+        elif isinstance(body, str):
+            body = body.encode()
+        
+        started = env.clock()
+        try:
+            if env.network is not None:
+                response = env.network(method, url, body, headers)
+            else:
+                response = self._send(method, url, body, headers, timeout or env.http_timeout)
+        except Exception:
+            env.requests.append((method, url, 0, env.clock() - started))
+            raise
+        env.requests.append((method, url, response.status_code, env.clock() - started))
+        return response
+
+    def _send(self, method, url, body, headers, timeout):
+        parts = urllib.parse.urlsplit(url)
+        if self._connection is None or self._netloc != parts.netloc:
+            connection_class = http.client.HTTPSConnection if parts.scheme == "https" else http.client.HTTPConnection
+            self._connection = connection_class(parts.netloc, timeout=timeout)
+            self._netloc = parts.netloc
+        path = parts.path + ("?" + parts.query if parts.query else "")
+        try:
+            self._connection.request(method, path, body=body, headers=headers)
+            raw = self._connection.getresponse()
+            content = raw.read()
+        except (OSError, http.client.HTTPException):
+            self._connection.close()
+            self._connection = None
+            raise
+        return FakeResponse(raw.status, content, dict(raw.getheaders()))
+
+    def post(self, url, **kwargs):
+        return self.request("POST", url, **kwargs)
+
+    def get(self, url, **kwargs):
+        return self.request("GET", url, **kwargs)
+
+
+def _json_dumps(value):
+    return json.dumps(value, separators=(",", ":"))
+
+
+# --- secrets -----------------------------------------------------------------
+
+class _FakeSecrets(dict):
+    """secrets dict whose server URL follows the calling device"""
+
+    def __getitem__(self, key):
+        if key == "url_mcp":
+            return current().server_url
+        return dict.__getitem__(self, key)
+
+
+def _module(name, **attributes):
+    module = types.ModuleType(name)
+    module.__dict__.update(attributes)
+    return module
+
+
+def build_fake_modules():
+    """Fake CircuitPython modules, keyed by import name
+
+    Returns:
+        dict: module name -> module
+    """
+    board = _module("board", I2C=FakeI2C)
+    board.__getattr__ = lambda name: name  # Pins are just their names
+    i2c_device = _module("adafruit_bus_device.i2c_device", I2CDevice=FakeI2CDevice)
+    bus_device = _module("adafruit_bus_device", i2c_device=i2c_device)
+    bus_device.__path__ = []
+    radio = _FakeRadio()
+    return {
+        "board": board,
+        "busio": _module("busio", I2C=FakeI2C),
+        "analogio": _module("analogio", AnalogIn=FakeAnalogIn),
+        "adafruit_dht": _module("adafruit_dht", DHT11=FakeDHT11, DHT22=FakeDHT11),
+        "pwmio": _module("pwmio", PWMOut=FakePWMOut),
+        "microcontroller": _module("microcontroller", cpu=_FakeCpu(), delay_us=lambda us: None),
+        "micropython": _module("micropython", const=lambda value: value),
+        "adafruit_bus_device": bus_device,
+        "adafruit_bus_device.i2c_device": i2c_device,
+        "wifi": _module("wifi", radio=radio),
+        "socketpool": _module("socketpool", SocketPool=FakeSocketPool),
+        "adafruit_requests": _module("adafruit_requests", Session=FakeSession, Response=FakeResponse),
+        "secrets": _module("secrets", secrets=_FakeSecrets(ssid="sim", password="sim")),
+    }
+
+
+def install_modules():
+    """Register the fake modules in sys.modules (replacing e.g. the stdlib secrets module)"""
+    sys.modules.update(build_fake_modules())
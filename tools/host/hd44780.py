@@ -0,0 +1,105 @@
+"""HD44780 character LCD behind a PCF8574 I2C expander, decoded from bus writes
+
+Each byte written to the expander sets the pins:
+
+    7  | 6  | 5  | 4  | 3  | 2  | 1  | 0
+    D7 | D6 | D5 | D4 | BL | EN | RW | RS
+
+The controller latches D7-D4 on the falling edge of EN. It starts in 8-bit
+mode, where one latch is a whole instruction; after a function set to 4-bit
+mode every value takes two latches, high nibble first.
+"""
+
+PIN_REGISTER_SELECT = 0x01
+PIN_ENABLE = 0x04
+PIN_BACKLIGHT = 0x08
+
+ROW_ADDRESSES = (0x00, 0x40, 0x14, 0x54)
+
+
+class HD44780:
+    """Display memory and controller state rebuilt from the I2C byte stream
+
+    Args:
+        rows (int): Visible rows
+        cols (int): Visible columns
+        on_change: Called as on_change(emulator) after every DDRAM write or clear
+    """
+
+    def __init__(self, rows=2, cols=16, on_change=None):
+        self.rows = rows
+        self.cols = cols
+        self.on_change = on_change
+        self.ddram = bytearray(b" " * 0x80)
+        self.address = 0
+        self.increment = True
+        self.display_on = False
+        self.eight_bit = True
+        self.backlight = False
+        self.pending_nibble = None
+        self.last_pins = 0
+        self.instructions = 0
+        self.characters = 0
+
+    def write(self, data):
+        """Feed bytes written to the expander"""
+        for pins in data:
+            self.backlight = bool(pins & PIN_BACKLIGHT)
+            if self.last_pins & PIN_ENABLE and not pins & PIN_ENABLE:
+                self._latch(self.last_pins >> 4, bool(self.last_pins & PIN_REGISTER_SELECT))
+            self.last_pins = pins
+
+    def _latch(self, nibble, is_data):
+        if self.eight_bit:
+            value = nibble << 4
+        elif self.pending_nibble is None:
+            self.pending_nibble = nibble
+            return
+        else:
+            value = (self.pending_nibble << 4) | nibble
+            self.pending_nibble = None
+
+        if is_data:
+            self._write_data(value)
+        else:
+            self._instruction(value)
+
+    def _instruction(self, value):
+        self.instructions += 1
+        if value & 0x80:
+            self.address = value & 0x7F
+        elif value & 0x40:
+            pass  # CGRAM address: custom characters are not emulated
+        elif value & 0x20:
+            self.eight_bit = bool(value & 0x10)
+            self.pending_nibble = None
+        elif value & 0x10:
+            pass  # Cursor or display shift
+        elif value & 0x08:
+            self.display_on = bool(value & 0x04)
+        elif value & 0x04:
+            self.increment = bool(value & 0x02)
+        elif value & 0x02:
+            self.address = 0
+        elif value & 0x01:
+            self.ddram[:] = b" " * len(self.ddram)
+            self.address = 0
+            self.increment = True
+            self._changed()
+
+    def _write_data(self, value):
+        self.characters += 1
+        self.ddram[self.address] = value
+        self.address = (self.address + (1 if self.increment else -1)) & 0x7F
+        self._changed()
+
+    def _changed(self):
+        if self.on_change is not None:
+            self.on_change(self)
+
+    def lines(self):
+        """Visible text, one string per row"""
+        return [
+            self.ddram[ROW_ADDRESSES[row]:ROW_ADDRESSES[row] + self.cols].decode("latin-1")
+            for row in range(self.rows)
+        ]
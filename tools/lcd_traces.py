@@ -0,0 +1,161 @@
+"""Golden I2C traces of every LCD screen the device shows
+
+    python -m tools.lcd_traces --check
+    python -m tools.lcd_traces --update
+    python -m tools.lcd_traces --show status_dry
+
+Renders each screen through LCDDisplay on a fresh display and records the
+exact bytes written to the PCF8574 expander, one entry per I2C transaction.
+The text each screen leaves on the glass is decoded from those bytes by the
+HD44780 emulator, so the golden file holds both what the bus carried and
+what a person would read.
+
+--check exits non-zero if a screen's decoded contents differ from the
+golden file or it takes more transactions or bytes than recorded. A
+cheaper byte stream with the same contents passes, with a reminder to run
+--update so the saving is locked in.
+"""
+import argparse
+import contextlib
+import json
+import os
+import sys
+from tools import host
+from tools.host.clock import no_sleep
+from tools.host.hd44780 import HD44780
+from tools.device_bench import NullWriter
+
+GOLDEN_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "lcd_golden_traces.json")
+
+# (soil, ambient humidity, temperature) giving each overall status
+READINGS = {
+    "good": (22000, 55.0, 22.0),
+    "dry": (28000, 55.0, 22.0),
+    "humid": (18000, 55.0, 22.0)
+}
+
+
+def screens():
+    """Screen renderers keyed by name, each taking a fresh LCDDisplay"""
+    from utils.soil_analyzer import PlantAnalyzer
+
+    analyzer = PlantAnalyzer()
+    statuses = {name: analyzer.get_comprehensive_status(*reading) for name, reading in READINGS.items()}
+    ambient = analyzer.interpret_ambient_conditions(80.0, 31.0)
+
+    return {
+        "startup": lambda display: display.display_startup_message(),
+        "status_good": lambda display: display.display_comprehensive_status(statuses["good"]),
+        "status_dry": lambda display: display.display_comprehensive_status(statuses["dry"]),
+        "status_humid": lambda display: display.display_comprehensive_status(statuses["humid"]),
+        "ambient_detail": lambda display: display.display_ambient_details(80.0, 31.0, ambient),
+        "ai_message": lambda display: display.display_custom_message("Feeling great", "22.0C 55%"),
+        "error": lambda display: display.display_error("Err 1")
+    }
+
+
+def capture():
+    """Trace every screen
+
+    Returns:
+        dict: Per screen, its decoded lines, transaction and byte counts and
+        the hex bytes of each transaction
+    """
+    host.install()
+    from display.lcd_display import LCDDisplay
+
+    env = host.activate(host.DeviceEnv())
+    traces = {}
+    with contextlib.redirect_stdout(NullWriter()), no_sleep():
+        for name, render in screens().items():
+            lcd = HD44780()
+            env.i2c_listener = lambda address, data: lcd.write(data)
+            display = LCDDisplay()
+
+            # Only the screen's own traffic is traced; the emulator still sees
+            # the initialization so it decodes in the right bus mode
+            env.i2c_log = []
+            render(display)
+            transactions = {}
+            for transaction, data in env.i2c_log:
+                transactions.setdefault(transaction, bytearray()).extend(data)
+            env.i2c_log = None
+            env.i2c_listener = None
+
+            traces[name] = {
+                "lines": [line.rstrip() for line in lcd.lines()],
+                "transactions": len(transactions),
+                "bytes": sum(len(data) for data in transactions.values()),
+                "trace": [data.hex() for data in transactions.values()]
+            }
+    return traces
+
+
+def compare(traces, golden):
+    """Compare a capture with the golden traces
+
+    Returns:
+        tuple: (failures, notes) as lists of descriptions
+    """
+    failures = []
+    notes = []
+    for name in sorted(set(traces) | set(golden)):
+        if name not in golden:
+            failures.append(f"{name}: no golden trace (run --update)")
+            continue
+        if name not in traces:
+            failures.append(f"{name}: screen no longer rendered")
+            continue
+        current, expected = traces[name], golden[name]
+        if current["lines"] != expected["lines"]:
+            failures.append(f"{name}: shows {current['lines']}, expected {expected['lines']}")
+            continue
+        increased = False
+        for metric in ("transactions", "bytes"):
+            if current[metric] > expected[metric]:
+                failures.append(f"{name}: {current[metric]} {metric}, golden {expected[metric]}")
+                increased = True
+        if not increased and current["trace"] != expected["trace"]:
+            notes.append(f"{name}: same contents in {current['transactions']} transactions and "
+                         f"{current['bytes']} bytes (golden {expected['transactions']} and "
+                         f"{expected['bytes']}); run --update if intended")
+    return failures, notes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--golden", default=GOLDEN_PATH)
+    parser.add_argument("--check", action="store_true", help="Exit 1 on changed contents or more bus traffic")
+    parser.add_argument("--update", action="store_true", help="Rewrite the golden traces from this run")
+    parser.add_argument("--show", nargs="+", metavar="SCREEN", help="Print the full trace of these screens")
+    args = parser.parse_args()
+
+    traces = capture()
+    print(f"{'screen':<16} {'transactions':>12} {'bytes':>6}  contents")
+    for name, trace in traces.items():
+        print(f"{name:<16} {trace['transactions']:>12} {trace['bytes']:>6}  {' | '.join(trace['lines'])}")
+    for name in args.show or []:
+        print(f"\n{name}:")
+        for index, data in enumerate(traces[name]["trace"]):
+            print(f"  {index:3d} {data}")
+
+    if args.update:
+        with open(args.golden, "w") as f:
+            json.dump(traces, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"Golden traces written to {args.golden}")
+    elif args.check:
+        with open(args.golden) as f:
+            golden = json.load(f)
+        failures, notes = compare(traces, golden)
+        for note in notes:
+            print("NOTE:", note)
+        for failure in failures:
+            print("FAIL:", failure, file=sys.stderr)
+        if failures:
+            sys.exit(1)
+        print("All screens match the golden traces")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,353 @@
+"""Compile a binary melody pack for provisioning boards at the factory
+
+    python -m tools.melody_pack --mock 40 --output melodies.bin
+    python -m tools.melody_pack --replay upstream_recordings.jsonl --curated curated.json
+    GEMINI_API_KEY=... python -m tools.melody_pack --gemini 10 --per-status 8 --json pack.json
+
+Collects responses per plant status from the mock upstream, recorded or
+live Gemini responses (live ones prompted with main.TEMPLATE and a reading
+that gives the status, recorded ones filed by the reading in their prompt) and/or a curated JSON file of {"status": ["MESSAGE: ...\\nMELODY:
+...", "C4,0.5,..."]}. Each melody is validated like the server does (notes
+C3-C6, sane durations), then normalized: durations rounded to 10 ms, runs of
+rests merged, leading and trailing rests dropped. Melodies that are too
+short, too long or duplicates are rejected with a reason.
+
+The pack holds note indices and millisecond durations with an offset index
+per status, in the layout utils/melody_pack.py reads; copy it to the
+board's MELODY_PACK_PATH (/melodies.bin). The report gives the pack size,
+what the board keeps in RAM and the cost of one lookup, measured with the
+device reader after every melody was read back and compared. Exits 1 if a
+status has fewer than --min-per-status melodies or the read-back differs.
+"""
+import argparse
+import json
+import os
+import re
+import statistics
+import struct
+import sys
+import time
+from server.melody import parse_melody, split_response, LOWEST_NOTE
+from utils import melody_pack
+from utils.melody_pack import MelodyPack, HEADER, STATUS_ENTRY, INDEX_ENTRY, NOTE, REST_INDEX
+
+# A reading that gives each overall status, for prompting the upstream
+STATUS_READINGS = {
+    "good": (22000, 55.0, 22.0),
+    "needs_water": (28000, 55.0, 22.0),
+    "too_wet": (18000, 55.0, 22.0),
+    "dry_air": (22000, 25.0, 22.0),
+    "humid_air": (22000, 85.0, 22.0),
+    "temp_stress": (22000, 55.0, 35.0)
+}
+STATUSES = tuple(STATUS_READINGS)
+
+DURATION_STEP_MS = 10
+MIN_SOUNDING_NOTES = 3
+MAX_NOTES = 32
+# Longer melodies hold up the monitoring loop (see tools/reaction_latency.py)
+MAX_MELODY_MS = 8000
+
+LOOKUP_REPEATS = 200
+
+
+def normalize(text):
+    """Validate a response or bare melody and normalize its notes
+
+    Returns:
+        tuple: (notes, None) with notes a tuple of (note index, milliseconds),
+        or (None, reason) if the melody is rejected
+    """
+    _, melody = split_response(text)
+    if not melody:
+        melody = text.strip()
+    try:
+        parsed = parse_melody(melody)
+    except ValueError as e:
+        return None, str(e)
+
+    notes = []
+    for number, duration in parsed:
+        index = REST_INDEX if number is None else number - LOWEST_NOTE
+        milliseconds = max(DURATION_STEP_MS, int(round(duration * 1000 / DURATION_STEP_MS)) * DURATION_STEP_MS)
+        if index == REST_INDEX and notes and notes[-1][0] == REST_INDEX:
+            notes[-1] = (REST_INDEX, notes[-1][1] + milliseconds)
+        else:
+            notes.append((index, milliseconds))
+    while notes and notes[0][0] == REST_INDEX:
+        notes.pop(0)
+    while notes and notes[-1][0] == REST_INDEX:
+        notes.pop()
+
+    if sum(index != REST_INDEX for index, _ in notes) < MIN_SOUNDING_NOTES:
+        return None, f"fewer than {MIN_SOUNDING_NOTES} notes"
+    if len(notes) > MAX_NOTES:
+        return None, f"more than {MAX_NOTES} notes"
+    if sum(milliseconds for _, milliseconds in notes) > MAX_MELODY_MS:
+        return None, f"longer than {MAX_MELODY_MS} ms"
+    return tuple(notes), None
+
+
+def upstream_responses(upstream, count, template):
+    """Ask an upstream for count responses per status
+
+    Returns:
+        dict: Response texts keyed by status
+    """
+    from main import GENERATION_CONFIG
+
+    responses = {}
+    for status, (soil, humidity, temperature) in STATUS_READINGS.items():
+        prompt = template.format(location="indoor", plant_type="houseplant", soil_moisture=float(soil),
+                                 temperature=temperature, humidity=humidity, history="first reading")
+        payload = {"contents": [{"parts": [{"text": prompt}]}], "generationConfig": GENERATION_CONFIG}
+        texts = responses.setdefault(status, [])
+        for _ in range(count):
+            response = upstream.generate(payload)
+            if response.status_code != 200:
+                continue
+            try:
+                texts.append(response.json()["candidates"][0]["content"]["parts"][0]["text"])
+            except (KeyError, IndexError, ValueError):
+                continue
+    return responses
+
+
+def reading_pattern(template, field):
+    """Regex capturing a field's value from prompts built with the template, or None"""
+    placeholder = "{%s}" % field
+    for line in template.splitlines():
+        if placeholder in line:
+            before, _, after = line.partition(placeholder)
+            return re.compile(re.escape(before) + r"([-+0-9.eE]+)" + re.escape(after))
+    return None
+
+
+def recorded_responses(path, count, template):
+    """Recorded upstream responses per status, classified by the reading in each prompt
+
+    Recorded prompts come from real devices, so each response is filed under
+    the status of its own reading; prompts the template does not match are
+    skipped.
+
+    Returns:
+        dict: Response texts keyed by status
+    """
+    from utils.soil_analyzer import PlantAnalyzer
+
+    analyzer = PlantAnalyzer()
+    patterns = {field: reading_pattern(template, field) for field in ("soil_moisture", "humidity", "temperature")}
+    responses = {status: [] for status in STATUSES}
+    with open(path) as f:
+        for line in f:
+            if not line.strip():
+                continue
+            record = json.loads(line)
+            if record.get("status", 200) != 200:
+                continue
+            try:
+                text = record["response"]["candidates"][0]["content"]["parts"][0]["text"]
+                soil, humidity, temperature = (float(pattern.search(record["prompt"]).group(1))
+                                               for pattern in patterns.values())
+            except (KeyError, IndexError, TypeError, AttributeError, ValueError):
+                continue
+            status = analyzer.get_comprehensive_status(soil, humidity, temperature)["overall_status"]
+            texts = responses.get(status)
+            if texts is not None and len(texts) < count:
+                texts.append(text)
+    return responses
+
+
+def mock_responses(count, seed):
+    """Mock upstream responses per status; the mock ignores the prompt, so no template is needed"""
+    from server.upstream import MockUpstream
+
+    mock = MockUpstream(seed=seed)
+    config = {"maxOutputTokens": 200, "temperature": 0.9}
+    return {status: [mock.compose(config) for _ in range(count)] for status in STATUSES}
+
+
+def curated_responses(path):
+    """Responses or bare melodies per status from a curated JSON file"""
+    with open(path) as f:
+        curated = json.load(f)
+    unknown = set(curated) - set(STATUSES)
+    if unknown:
+        raise ValueError(f"Unknown statuses in {path}: {', '.join(sorted(unknown))}")
+    return curated
+
+
+def select(sources, per_status):
+    """Normalize every response and keep up to per_status distinct melodies per status
+
+    Curated entries come first in sources, so they are kept before generated ones.
+
+    Returns:
+        tuple: (melodies keyed by status, rejection reasons with counts)
+    """
+    melodies = {status: [] for status in STATUSES}
+    rejected = {}
+    for responses in sources:
+        for status, texts in responses.items():
+            for text in texts:
+                notes, reason = normalize(text)
+                if notes is None:
+                    # Grouped by kind; the offending note or duration varies
+                    reason = reason.split(":")[0]
+                    rejected[reason] = rejected.get(reason, 0) + 1
+                elif notes in melodies[status]:
+                    rejected["duplicate"] = rejected.get("duplicate", 0) + 1
+                elif len(melodies[status]) < per_status:
+                    melodies[status].append(notes)
+    return melodies, rejected
+
+
+def build_pack(melodies):
+    """Serialize melodies in the device pack layout
+
+    Returns:
+        bytes: Pack contents
+    """
+    statuses = [status for status in STATUSES if melodies[status]]
+    ordered = [notes for status in statuses for notes in melodies[status]]
+    if len(statuses) > 255 or len(ordered) > 0xFFFF:
+        raise ValueError("Too many statuses or melodies for the pack header")
+
+    pack = bytearray(struct.pack(HEADER, melody_pack.MAGIC, melody_pack.VERSION, len(statuses), len(ordered)))
+    first = 0
+    for status in statuses:
+        name = status.encode()
+        pack += bytes([len(name)]) + name + struct.pack(STATUS_ENTRY, first, len(melodies[status]))
+        first += len(melodies[status])
+
+    offset = 0
+    for notes in ordered:
+        pack += struct.pack(INDEX_ENTRY, offset, len(notes))
+        offset += len(notes) * melody_pack.NOTE_SIZE
+    for notes in ordered:
+        for index, milliseconds in notes:
+            pack += struct.pack(NOTE, index, milliseconds)
+    return bytes(pack)
+
+
+def verify(path, melodies):
+    """Read every melody back with the device reader and time the lookups
+
+    Returns:
+        tuple: (mismatches, mean microseconds per lookup)
+    """
+    pack = MelodyPack(path)
+    mismatches = []
+    lookups = []
+    for status, entries in melodies.items():
+        for choice, notes in enumerate(entries):
+            expected = ",".join(f"{melody_pack.note_name(index)},{milliseconds / 1000}"
+                                for index, milliseconds in notes)
+            if pack.melody(status, choice) != expected:
+                mismatches.append(f"{status} #{choice}")
+            lookups.append((status, choice))
+    if not lookups:
+        return mismatches, None
+
+    started = time.perf_counter()
+    for _ in range(LOOKUP_REPEATS):
+        for status, choice in lookups:
+            pack.melody(status, choice)
+    elapsed = time.perf_counter() - started
+    return mismatches, elapsed / (LOOKUP_REPEATS * len(lookups)) * 1e6
+
+
+def report(pack, melodies, rejected, lookup_us):
+    """Size and lookup cost of a pack"""
+    statuses = [status for status in STATUSES if melodies[status]]
+    melody_count = sum(len(entries) for entries in melodies.values())
+    table_bytes = struct.calcsize(HEADER) + sum(1 + len(status) + struct.calcsize(STATUS_ENTRY)
+                                                for status in statuses)
+    index_bytes = melody_count * struct.calcsize(INDEX_ENTRY)
+    record_bytes = [struct.calcsize(INDEX_ENTRY) + len(notes) * melody_pack.NOTE_SIZE
+                    for entries in melodies.values() for notes in entries]
+    return {
+        "pack_bytes": len(pack),
+        "table_bytes": table_bytes,
+        "index_bytes": index_bytes,
+        "note_bytes": len(pack) - table_bytes - index_bytes,
+        "melodies": {status: len(melodies[status]) for status in STATUSES},
+        "rejected": rejected,
+        "lookup": {
+            # Read once at boot and kept in RAM; everything else stays on flash
+            "boot_read_bytes": table_bytes,
+            "file_reads": 2,
+            "bytes_read_mean": round(statistics.mean(record_bytes), 1) if record_bytes else None,
+            "bytes_read_max": max(record_bytes) if record_bytes else None,
+            "host_us_mean": round(lookup_us, 2) if lookup_us is not None else None
+        }
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--mock", type=int, default=0, metavar="N", help="Mock upstream responses per status")
+    parser.add_argument("--seed", type=int, default=1, help="Mock upstream seed")
+    parser.add_argument("--replay", metavar="PATH", help="Recorded upstream responses (UPSTREAM_RECORD_PATH)")
+    parser.add_argument("--replay-count", type=int, default=20, help="Replayed responses per status")
+    parser.add_argument("--gemini", type=int, default=0, metavar="N",
+                        help="Live Gemini responses per status (needs GEMINI_API_KEY)")
+    parser.add_argument("--curated", nargs="+", default=[], metavar="PATH", help="Curated responses per status")
+    parser.add_argument("--per-status", type=int, default=8, help="Most melodies kept per status")
+    parser.add_argument("--min-per-status", type=int, default=1, help="Exit 1 if a status has fewer melodies")
+    parser.add_argument("--output", default="melodies.bin", help="Pack file to write")
+    parser.add_argument("--json", help="Write the report to this file")
+    args = parser.parse_args()
+
+    sources = [curated_responses(path) for path in args.curated]
+    if args.replay or args.gemini:
+        from main import TEMPLATE
+        from server.upstream import GeminiClient
+        if args.replay:
+            sources.append(recorded_responses(args.replay, args.replay_count, TEMPLATE))
+        if args.gemini:
+            api_key = os.getenv("GEMINI_API_KEY")
+            if not api_key:
+                parser.error("--gemini needs GEMINI_API_KEY")
+            client = GeminiClient(api_key)
+            try:
+                sources.append(upstream_responses(client, args.gemini, TEMPLATE))
+            finally:
+                client.close()
+    if args.mock:
+        sources.append(mock_responses(args.mock, args.seed))
+    if not sources:
+        parser.error("give at least one of --mock, --replay, --gemini or --curated")
+
+    melodies, rejected = select(sources, args.per_status)
+    pack = build_pack(melodies)
+    with open(args.output, "wb") as f:
+        f.write(pack)
+    mismatches, lookup_us = verify(args.output, melodies)
+    summary = report(pack, melodies, rejected, lookup_us)
+
+    print(f"Wrote {args.output}: {summary['pack_bytes']} bytes "
+          f"(table {summary['table_bytes']}, index {summary['index_bytes']}, notes {summary['note_bytes']})")
+    for status, count in summary["melodies"].items():
+        print(f"  {status:<12} {count:>3} melodies")
+    for reason, count in sorted(rejected.items(), key=lambda item: -item[1]):
+        print(f"  rejected {count:>4}: {reason}")
+    lookup = summary["lookup"]
+    print(f"Lookup: {lookup['boot_read_bytes']} bytes read at boot, then {lookup['file_reads']} reads of "
+          f"{lookup['bytes_read_mean']} bytes on average (max {lookup['bytes_read_max']}), "
+          f"{lookup['host_us_mean']} us on this host")
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(summary, f, indent=2)
+
+    failures = [f"read back differs: {mismatch}" for mismatch in mismatches]
+    failures += [f"{status}: {count} melodies, need {args.min_per_status}"
+                 for status, count in summary["melodies"].items() if count < args.min_per_status]
+    for failure in failures:
+        print("FAIL:", failure, file=sys.stderr)
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,215 @@
+"""Benchmark prompt templates and generation settings over a fixed corpus of plant states
+
+    python -m tools.prompt_bench                        # current TEMPLATE and a few variants, mock upstream
+    python -m tools.prompt_bench --matrix variants.json --record prompt_recordings.jsonl   # needs GEMINI_API_KEY
+    python -m tools.prompt_bench --matrix variants.json --replay prompt_recordings.jsonl
+
+A matrix file looks like:
+
+    {"templates": {"current": "@main", "short": "Plant {plant_type} ... MELODY: ..."},
+     "generation_configs": {"default": "@main", "cool": {"temperature": 0.5, "maxOutputTokens": 120}}}
+
+"@main" refers to TEMPLATE / GENERATION_CONFIG in main.py; "@file.txt" loads a template file.
+
+--record runs the matrix against Gemini and records every exchange, so
+--replay can later score each variant on responses to its own prompt and
+generationConfig, with the recorded latencies. Server recordings
+(UPSTREAM_RECORD_PATH) only cover the server's own template and history
+strings, not the corpus.
+"""
+import argparse
+import itertools
+import json
+import statistics
+import time
+from main import API_KEY, TEMPLATE, GENERATION_CONFIG
+from server.melody import parse_melody, split_response
+from server.upstream import GeminiClient, MockUpstream, RecordingUpstream, ReplayUpstream, estimate_tokens
+
+# Plant states every variant is run over: soil x temperature x humidity
+CORPUS_SOIL = (15000, 23000, 29000)
+CORPUS_TEMPERATURE = (12.0, 24.0, 34.0)
+CORPUS_HUMIDITY = (30.0, 60.0, 85.0)
+CORPUS_HISTORY = ("first reading", "drying (+900/h); watered 2d3h ago; normal for 1d")
+
+COMPACT_TEMPLATE = """Plant: {plant_type}, {location}. Soil {soil_moisture} (raw, >26000 dry, <20000 wet), {temperature}C, {humidity}%RH. History: {history}.
+Reply exactly:
+MESSAGE: <max 16 chars>
+MELODY: <note,seconds,...> notes C3-C6 or R, matching the plant's mood. Vary it every time."""
+
+DEFAULT_MATRIX = {
+    "templates": {"current": "@main", "compact": COMPACT_TEMPLATE},
+    "generation_configs": {
+        "current": "@main",
+        "short_output": dict(GENERATION_CONFIG, maxOutputTokens=80),
+        "cooler": dict(GENERATION_CONFIG, temperature=0.6)
+    }
+}
+
+# Device LCD width: longer messages get truncated on the device
+MAX_MESSAGE_LENGTH = 16
+
+
+def corpus():
+    """The fixed list of plant states"""
+    return [
+        {"location": "indoor", "plant_type": "houseplant", "soil_moisture": soil,
+         "temperature": temperature, "humidity": humidity, "history": history}
+        for soil, temperature, humidity, history in itertools.product(
+            CORPUS_SOIL, CORPUS_TEMPERATURE, CORPUS_HUMIDITY, CORPUS_HISTORY)
+    ]
+
+
+def resolve_matrix(matrix):
+    """Replace "@main" and "@file" references with their contents"""
+    templates = {}
+    for name, template in matrix["templates"].items():
+        if template == "@main":
+            template = TEMPLATE
+        elif template.startswith("@"):
+            with open(template[1:]) as f:
+                template = f.read()
+        templates[name] = template
+    configs = {
+        name: GENERATION_CONFIG if config == "@main" else config
+        for name, config in matrix["generation_configs"].items()
+    }
+    return templates, configs
+
+
+def validate(text):
+    """Check a response the way the device uses it
+
+    Returns:
+        tuple: (parsed, valid, notes) - parsed if both fields were found, valid if
+            the melody is in range and the message fits the LCD
+    """
+    message, melody = split_response(text)
+    if not message or not melody:
+        return False, False, None
+    try:
+        notes = parse_melody(melody)
+    except ValueError:
+        return True, False, None
+    return True, len(message) <= MAX_MESSAGE_LENGTH, notes
+
+
+def run_variant(upstream, template, config, states, repeats):
+    """Run one template/config pair over the corpus
+
+    With a replay upstream, only states whose prompt was recorded with this
+    config are scored; the rest are counted as unmatched.
+
+    Returns:
+        dict: Token, latency, success and melody statistics
+    """
+    prompt_tokens, output_tokens, latencies = [], [], []
+    note_counts, durations = [], []
+    parsed_count = valid_count = calls = unmatched = 0
+    
+    for state in states:
+        prompt = template.format(**state)
+        # A replayed request without a recording would be scored on another request's answer
+        if hasattr(upstream, "has_recording") and not upstream.has_recording(prompt, config):
+            unmatched += 1
+            continue
+        payload = {"contents": [{"parts": [{"text": prompt}]}], "generationConfig": config}
+        for _ in range(repeats):
+            calls += 1
+            started = time.perf_counter()
+            response = upstream.generate(payload)
+            latencies.append(time.perf_counter() - started)
+            if response.status_code != 200:
+                continue
+            body = response.json()
+            try:
+                text = body["candidates"][0]["content"]["parts"][0]["text"]
+            except (KeyError, IndexError):
+                continue
+            usage = body.get("usageMetadata", {})
+            prompt_tokens.append(usage.get("promptTokenCount", estimate_tokens(prompt)))
+            output_tokens.append(usage.get("candidatesTokenCount", estimate_tokens(text)))
+            
+            parsed, valid, notes = validate(text)
+            parsed_count += parsed
+            valid_count += valid
+            if notes:
+                note_counts.append(len(notes))
+                durations.append(sum(duration for _, duration in notes))
+    
+    def mean(values):
+        return round(statistics.mean(values), 2) if values else None
+    
+    return {
+        "calls": calls,
+        "unmatched_prompts": unmatched,
+        "prompt_tokens": mean(prompt_tokens),
+        "output_tokens": mean(output_tokens),
+        "latency_ms_mean": round(statistics.mean(latencies) * 1000, 2) if latencies else None,
+        "latency_ms_max": round(max(latencies) * 1000, 2) if latencies else None,
+        "parse_rate": round(parsed_count / calls, 4) if calls else None,
+        "valid_rate": round(valid_count / calls, 4) if calls else None,
+        "notes_mean": mean(note_counts),
+        "notes_max": max(note_counts) if note_counts else None,
+        "melody_seconds_mean": mean(durations),
+        "melody_seconds_max": round(max(durations), 2) if durations else None
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--matrix", help="JSON file with templates and generation_configs")
+    parser.add_argument("--replay", help="Recorded responses (--record output) instead of the mock")
+    parser.add_argument("--record", help="Call Gemini and append every exchange to this file")
+    parser.add_argument("--repeats", type=int, default=5, help="Calls per plant state")
+    parser.add_argument("--mock-latency", type=float, default=0.0, help="Seconds per mock upstream call")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--json", help="Also write results to this file")
+    args = parser.parse_args()
+    if args.record and args.replay:
+        parser.error("--record and --replay are exclusive")
+    if args.record and not API_KEY:
+        parser.error("--record needs GEMINI_API_KEY")
+
+    matrix = DEFAULT_MATRIX
+    if args.matrix:
+        with open(args.matrix) as f:
+            matrix = json.load(f)
+    templates, configs = resolve_matrix(matrix)
+    states = corpus()
+
+    recorder = RecordingUpstream(GeminiClient(API_KEY), args.record) if args.record else None
+    results = []
+    for (template_name, template), (config_name, config) in itertools.product(templates.items(), configs.items()):
+        # Fresh upstream per variant so each sees the same random sequence
+        if recorder:
+            upstream = recorder
+        elif args.replay:
+            upstream = ReplayUpstream(args.replay, use_latency=True)
+        else:
+            upstream = MockUpstream(args.mock_latency, seed=args.seed)
+        result = run_variant(upstream, template, config, states, args.repeats)
+        result.update(template=template_name, generation_config=config_name)
+        results.append(result)
+    if recorder:
+        recorder.close()
+
+    columns = ("template", "generation_config", "prompt_tokens", "output_tokens", "latency_ms_mean",
+               "parse_rate", "valid_rate", "notes_mean", "melody_seconds_mean", "unmatched_prompts")
+    print("  ".join(f"{column:>18}" for column in columns))
+    for result in results:
+        print("  ".join(f"{str(result[column]):>18}" for column in columns))
+    for result in results:
+        if not result["calls"]:
+            print(f"NOT SCORED: {result['template']}/{result['generation_config']} has no recorded prompts "
+                  f"in {args.replay}; record it with --record first")
+        elif result["unmatched_prompts"]:
+            print(f"NOTE: {result['template']}/{result['generation_config']} scored on "
+                  f"{len(states) - result['unmatched_prompts']} of {len(states)} states with recordings")
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
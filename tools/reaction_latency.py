@@ -0,0 +1,213 @@
+"""Measure how fast the device reacts to a change in soil moisture
+
+    python -m tools.reaction_latency
+    python -m tools.reaction_latency --delays 0,5,20 --phases 16 --json latency.json
+    python -m tools.reaction_latency --display-budget 45 --alert-budget 45
+
+Runs the unmodified monitoring loop on the host fakes and a virtual clock.
+After a warm-up, with an AI melody cached and replaying every cycle, the
+soil reading steps from healthy to dry at a series of offsets into the
+loop, often in the middle of a melody note or a request. For every step it
+records the simulated seconds until:
+
+    display  the LCD, decoded from the I2C bytes, first shows the dry state
+    alert    the buzzer first starts a note of the dry melody or alert
+
+Each run is repeated with the server answering after every scripted
+network delay. A reaction needs two round trips (submit the job, collect
+the result), so budgets are in seconds beyond twice the delay. Exits with
+status 1 if the worst latency for any delay exceeds its budget, so a change
+that adds a blocking wait to the loop fails the check.
+"""
+import argparse
+import contextlib
+import json
+import statistics
+import sys
+from tools import host
+from tools.host.clock import VirtualClock
+from tools.host.fakes import FakeResponse
+from tools.host.hd44780 import HD44780
+from tools.device_bench import NullWriter
+
+HEALTHY_SOIL = 22000
+DRY_SOIL = 32000
+WARM_UP = 60.0
+TIMEOUT = 600.0
+
+HEALTHY_RESPONSE = "MESSAGE: Feeling great\nMELODY: E5,0.4,G5,0.4,C6,0.8,G5,0.4,E5,0.4"
+DRY_MESSAGE = "Water me soon"
+DRY_RESPONSE = f"MESSAGE: {DRY_MESSAGE}\nMELODY: F#3,0.4,A3,0.4,F#3,0.8"
+
+# Screens and notes that can only come from the dry reading: the scripted AI
+# reply, or the standard status and alert when no AI reply is available
+DRY_SCREENS = (DRY_MESSAGE, "Soil: Dry")
+DRY_FREQUENCIES = {185, 196, 220, 262}
+
+# Defaults sit just above the current worst case: the rest of an AI request
+# interval, a job poll and up to two loop cycles with the cached melody
+DEFAULT_DISPLAY_BUDGET = 60.0
+DEFAULT_ALERT_BUDGET = 60.0
+
+# Spreads offsets without lining them up with the loop period
+GOLDEN_RATIO_FRACTION = 0.6180339887
+
+
+class ScriptedServer:
+    """env.network hook: async AI jobs answered after a fixed delay
+
+    Replies depend on the soil value the device submitted, so the device only
+    hears the dry melody once it has sent a reading taken after the step.
+    """
+
+    def __init__(self, clock, delay):
+        self.clock = clock
+        self.delay = delay
+        self.jobs = {}
+
+    def respond(self, method, url, body, headers):
+        self.clock.sleep(self.delay)
+        if "/profiles/" in url:
+            return FakeResponse(404, b'{"error": "Unknown species"}')
+        if method == "POST":
+            ticket = str(len(self.jobs) + 1)
+            self.jobs[ticket] = json.loads(body)["soil_moisture"]
+            return FakeResponse(202, json.dumps({"ticket": ticket, "retry_after": 2}).encode())
+        soil = self.jobs.get(url.rsplit("/", 1)[-1])
+        if soil is None:
+            return FakeResponse(404, b'{"error": "Unknown ticket"}')
+        reply = DRY_RESPONSE if soil > 26000 else HEALTHY_RESPONSE
+        return FakeResponse(200, json.dumps({"respuesta": reply}).encode())
+
+
+def measure(code, delay, offset):
+    """Step the soil reading once and time the device's reaction
+
+    Args:
+        code (module): The device's code.py
+        delay (float): Seconds the server takes to answer each request
+        offset (float): Seconds after the warm-up at which the soil dries
+
+    Returns:
+        dict: Step time, latencies (None if not seen within TIMEOUT) and
+        whether a melody was playing at the step
+    """
+    clock = VirtualClock()
+    env = host.activate(host.DeviceEnv(soil=HEALTHY_SOIL))
+    env.clock = clock.monotonic
+    env.network = ScriptedServer(clock, delay).respond
+    env.buzzer_log = []
+    result = {"offset": offset, "display": None, "alert": None, "during_melody": False}
+    step = WARM_UP + offset
+
+    def on_change(lcd):
+        if result["display"] is None and clock.now >= step and lcd.lines()[0].rstrip() in DRY_SCREENS:
+            result["display"] = round(clock.now - step, 3)
+
+    lcd = HD44780(on_change=on_change)
+    env.i2c_listener = lambda address, data: lcd.write(data)
+
+    def dry_out():
+        env.soil = DRY_SOIL
+        result["during_melody"] = env.buzzer_on_since is not None
+        del env.buzzer_log[:]
+
+    clock.at(step, dry_out)
+
+    with clock.installed(), contextlib.redirect_stdout(NullWriter()):
+        monitor = code.PlantMonitor()
+        monitor.startup_sequence()
+        monitor.is_running = True
+        while clock.now < step + TIMEOUT and monitor.is_running:
+            monitor.read_and_display_status()
+            if result["alert"] is None and clock.now >= step:
+                for when, frequency, duty_cycle in env.buzzer_log:
+                    if duty_cycle and frequency in DRY_FREQUENCIES:
+                        result["alert"] = round(when - step, 3)
+                        break
+                del env.buzzer_log[:]
+            if result["display"] is not None and result["alert"] is not None:
+                break
+            clock.sleep(code.MAIN_LOOP_DELAY)
+    return result
+
+
+def run(delays, phases, span):
+    """Measure every delay at phases offsets spread over span seconds
+
+    Returns:
+        dict: Per-delay summaries keyed by delay
+    """
+    code = host.install()
+    report = {}
+    for delay in delays:
+        offsets = [round(span * ((i * GOLDEN_RATIO_FRACTION) % 1.0), 3) for i in range(phases)]
+        trials = [measure(code, delay, offset) for offset in offsets]
+        summary = {"trials": trials, "during_melody": sum(t["during_melody"] for t in trials)}
+        for kind in ("display", "alert"):
+            values = [t[kind] for t in trials]
+            missed = sum(value is None for value in values)
+            seen = [value for value in values if value is not None]
+            summary[kind] = {
+                "missed": missed,
+                "median": round(statistics.median(seen), 3) if seen else None,
+                "max": None if missed or not seen else max(seen)
+            }
+        report[str(delay)] = summary
+    return report
+
+
+def check(report, display_budget, alert_budget):
+    """List every delay whose worst latency exceeds its budget plus two round trips
+
+    Returns:
+        list: Human-readable breaches, empty if within budget
+    """
+    breaches = []
+    for delay, summary in report.items():
+        for kind, budget in (("display", display_budget), ("alert", alert_budget)):
+            worst = summary[kind]["max"]
+            if worst is None:
+                breaches.append(f"delay {delay}s: {kind} never reacted within {TIMEOUT:.0f}s")
+            elif worst > budget + 2 * float(delay):
+                breaches.append(f"delay {delay}s: {kind} took {worst:.1f}s, "
+                                f"budget {budget:.1f}s + {2 * float(delay):.1f}s network")
+    return breaches
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--delays", default="0,3,15",
+                        help="Comma-separated server response delays in seconds")
+    parser.add_argument("--phases", type=int, default=12, help="Step offsets measured per delay")
+    parser.add_argument("--span", type=float, default=None,
+                        help="Seconds the offsets are spread over (default: AI interval + loop delay)")
+    parser.add_argument("--display-budget", type=float, default=DEFAULT_DISPLAY_BUDGET,
+                        help="Seconds allowed until the LCD shows the new state, excluding network delay")
+    parser.add_argument("--alert-budget", type=float, default=DEFAULT_ALERT_BUDGET,
+                        help="Seconds allowed until the first note of the new alert, excluding network delay")
+    parser.add_argument("--json", help="Write the full report to this file")
+    args = parser.parse_args()
+
+    import config
+    span = args.span if args.span is not None else config.AI_REQUEST_INTERVAL + config.MAIN_LOOP_DELAY
+    delays = [float(value) for value in args.delays.split(",")]
+    report = run(delays, args.phases, span)
+
+    print(f"{'delay':>7} {'display med':>12} {'display max':>12} {'alert med':>10} {'alert max':>10} {'in melody':>10}")
+    for delay, summary in report.items():
+        display, alert = summary["display"], summary["alert"]
+        print(f"{delay + 's':>7} {display['median']!s:>12} {display['max']!s:>12} "
+              f"{alert['median']!s:>10} {alert['max']!s:>10} {summary['during_melody']:>7}/{args.phases}")
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=2)
+
+    breaches = check(report, args.display_budget, args.alert_budget)
+    for breach in breaches:
+        print("OVER BUDGET:", breach, file=sys.stderr)
+    sys.exit(1 if breaches else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,125 @@
+"""Replay a /consulta capture against a server with the original arrival pattern
+
+    python -m tools.replay_traffic capture.bin --target http://localhost:8000 --speed 10
+"""
+import argparse
+import json
+import threading
+import time
+import urllib.error
+import urllib.request
+from collections import Counter
+from concurrent.futures import ThreadPoolExecutor
+from server.capture import read_capture
+
+MIN_SPEED = 1.0
+MAX_SPEED = 100.0
+
+
+def percentile(values, fraction):
+    """Nearest-rank percentile of a list (0.0 for an empty list)"""
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    index = min(len(ordered) - 1, int(fraction * len(ordered)))
+    return ordered[index]
+
+
+def send(url, body, timeout):
+    """POST one captured body
+
+    Returns:
+        tuple: (status code or 0 on network error, latency seconds)
+    """
+    request = urllib.request.Request(url, data=body, headers={"Content-Type": "application/json"})
+    started = time.perf_counter()
+    try:
+        with urllib.request.urlopen(request, timeout=timeout) as response:
+            response.read()
+            status = response.status
+    except urllib.error.HTTPError as e:
+        status = e.code
+    except (urllib.error.URLError, OSError):
+        status = 0
+    return status, time.perf_counter() - started
+
+
+def replay(records, url, speed, workers, timeout):
+    """Replay records, scheduling each at its original offset divided by speed
+
+    Returns:
+        dict: Replay report
+    """
+    results = []
+    lags = []
+    lock = threading.Lock()
+
+    def run(body):
+        status, latency = send(url, body, timeout)
+        with lock:
+            results.append((status, latency))
+
+    started = time.perf_counter()
+    with ThreadPoolExecutor(max_workers=workers) as pool:
+        for offset, _, _, body in records:
+            due = started + offset / speed
+            delay = due - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+            lags.append(max(0.0, time.perf_counter() - due))
+            pool.submit(run, body)
+    elapsed = time.perf_counter() - started
+
+    latencies = [latency for status, latency in results if status]
+    captured = [latency for _, latency, _, _ in records]
+    span = records[-1][0] / speed if records else 0.0
+    return {
+        "target": url,
+        "speed": speed,
+        "requests": len(results),
+        "elapsed_s": round(elapsed, 3),
+        "offered_rate": round(len(records) / span, 2) if span else None,
+        "achieved_rate": round(len(results) / elapsed, 2) if elapsed else None,
+        "status": dict(Counter(str(status) for status, _ in results)),
+        "latency_ms": {
+            "p50": round(percentile(latencies, 0.50) * 1000, 1),
+            "p90": round(percentile(latencies, 0.90) * 1000, 1),
+            "p99": round(percentile(latencies, 0.99) * 1000, 1),
+            "max": round(max(latencies, default=0.0) * 1000, 1)
+        },
+        "captured_latency_ms": {
+            "p50": round(percentile(captured, 0.50) * 1000, 1),
+            "p99": round(percentile(captured, 0.99) * 1000, 1)
+        },
+        "schedule_lag_ms_p99": round(percentile(lags, 0.99) * 1000, 1)
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="Capture file written with CAPTURE_PATH")
+    parser.add_argument("--target", default="http://localhost:8000", help="Server base URL")
+    parser.add_argument("--speed", type=float, default=1.0, help="Replay speed, 1x to 100x")
+    parser.add_argument("--workers", type=int, default=256, help="Maximum concurrent requests")
+    parser.add_argument("--timeout", type=float, default=30.0, help="Per-request timeout in seconds")
+    parser.add_argument("--limit", type=int, help="Replay only the first N requests")
+    parser.add_argument("--json", help="Also write the report to this file")
+    args = parser.parse_args()
+
+    if not MIN_SPEED <= args.speed <= MAX_SPEED:
+        parser.error(f"--speed must be between {MIN_SPEED:g} and {MAX_SPEED:g}")
+
+    start_time, records = read_capture(args.capture)
+    if args.limit:
+        records = records[:args.limit]
+    print(f"Replaying {len(records)} requests captured at {time.ctime(start_time)} at {args.speed:g}x")
+
+    report = replay(records, args.target.rstrip("/") + "/consulta", args.speed, args.workers, args.timeout)
+    print(json.dumps(report, indent=2))
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
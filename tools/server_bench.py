@@ -0,0 +1,455 @@
+"""Microbenchmarks of the server's request path, in process
+
+    python -m tools.server_bench --json server_bench.json
+    python -m tools.server_bench --compare server_bench.json
+    python -m tools.server_bench --only consulta_upstream stage_validate --samples 2000
+
+Drives main.app through the ASGI interface with no sockets, against a fake
+upstream that answers with canned Gemini bodies, so the figures are the
+server's own work. Whole-request cases go through the compression
+middleware, routing, admission and the worker pool; stage cases call the
+steps of a /consulta request directly:
+
+    stage_validate       parse_context on a request body
+    stage_prompt         TEMPLATE formatting and the upstream payload
+    stage_upstream_call  ask_upstream around an upstream that returns at once
+    stage_decode         decoding a Gemini response body, as requests does
+    stage_encode         JSONResponse rendering of a result
+
+Each case reports median and 90th percentile CPU time per request (all
+threads of the process, so work in the worker pool counts), wall time,
+and the tracemalloc peak and retained bytes per request.
+
+Save a run with --json on one commit and pass it to --compare on another:
+the run exits non-zero if a case got slower or allocates more than the
+tolerances allow. Compare runs from the same host and Python build.
+"""
+import os
+
+# Before main is imported: no trace export files, no traffic capture
+os.environ["TRACE_EXPORT_PATH"] = ""
+os.environ.pop("TRACE_COLLECTOR", None)
+os.environ.pop("CAPTURE_PATH", None)
+os.environ.pop("UPSTREAM_RECORD_PATH", None)
+
+import argparse
+import asyncio
+import contextlib
+import gc
+import json
+import platform
+import statistics
+import subprocess
+import sys
+import time
+import tracemalloc
+import main
+from server.compression import encode_body
+from server.upstream import MockUpstream, gemini_body
+
+# Allowed growth over the baseline before --compare fails; CPU time is far noisier than allocations
+DEFAULT_CPU_TOLERANCE = 0.25
+DEFAULT_ALLOC_TOLERANCE = 0.10
+ALLOC_SLACK_BYTES = 256
+
+CONTEXT = {"location": "indoor", "plant_type": "houseplant", "soil_moisture": 27500.0,
+           "temperature": 23.5, "humidity": 48.0, "device_id": "bench-01"}
+BODY = json.dumps(CONTEXT).encode()
+MISSING_FIELD_BODY = json.dumps({k: v for k, v in CONTEXT.items() if k != "humidity"}).encode()
+INVALID_JSON_BODY = BODY[:-8]
+CONFLICT_BODY = json.dumps(dict(CONTEXT, humidity=71.0)).encode()
+# A plant state no successful case caches, so a failing upstream has no cached response to fall back on
+UNCACHED_BODY = json.dumps(dict(CONTEXT, soil_moisture=12500.0)).encode()
+CANNED_RESPONSES = 16
+
+
+class DecodingResponse:
+    """Upstream response that decodes its body on every json() call, like requests.Response"""
+
+    def __init__(self, status_code, text):
+        self.status_code = status_code
+        self.text = text
+
+    def json(self):
+        return json.loads(self.text)
+
+
+class BenchUpstream:
+    """Fake upstream cycling through canned Gemini bodies
+
+    The bodies are composed by MockUpstream up front, so a call costs a list
+    lookup and the benchmark measures the server rather than the fake.
+    """
+
+    def __init__(self, seed=1, failing=False):
+        mock = MockUpstream(seed=seed)
+        self.bodies = [json.dumps(gemini_body(mock.compose(main.GENERATION_CONFIG), "bench"))
+                       for _ in range(CANNED_RESPONSES)]
+        self.error = json.dumps({"error": {"code": 500, "message": "Bench upstream failure"}})
+        self.failing = failing
+        self.calls = 0
+
+    def warm_up(self, connections=4):
+        return connections
+
+    def generate(self, payload):
+        self.calls += 1
+        if self.failing:
+            return DecodingResponse(500, self.error)
+        return DecodingResponse(200, self.bodies[self.calls % CANNED_RESPONSES])
+
+    def close(self):
+        pass
+
+
+class NullTrace:
+    """RequestTrace stand-in for the stage cases"""
+
+    trace_id = "0" * 16
+
+    def span(self, name):
+        return contextlib.nullcontext()
+
+    def add_span(self, name, start, end):
+        pass
+
+    def set(self, key, value):
+        pass
+
+
+async def call(method, path, body=b"", headers=()):
+    """One request through the ASGI app
+
+    Returns:
+        tuple: (status, body bytes)
+    """
+    request_headers = [(b"content-type", b"application/json"), (b"content-length", str(len(body)).encode())]
+    # ASGI servers hand over header names in lower case
+    request_headers.extend((name.lower().encode("latin-1"), value.encode("latin-1")) for name, value in headers)
+    scope = {
+        "type": "http",
+        "asgi": {"version": "3.0"},
+        "http_version": "1.1",
+        "method": method,
+        "scheme": "http",
+        "path": path,
+        "raw_path": path.encode(),
+        "query_string": b"",
+        "root_path": "",
+        "headers": request_headers,
+        "client": ("127.0.0.1", 50000),
+        "server": ("bench", 80)
+    }
+    finished = asyncio.Event()
+    delivered = False
+    status = None
+    chunks = []
+
+    async def receive():
+        nonlocal delivered
+        if not delivered:
+            delivered = True
+            return {"type": "http.request", "body": body, "more_body": False}
+        # Only reports a disconnect once the response is complete
+        await finished.wait()
+        return {"type": "http.disconnect"}
+
+    async def send(message):
+        nonlocal status
+        if message["type"] == "http.response.start":
+            status = message["status"]
+        elif message["type"] == "http.response.body":
+            chunks.append(message.get("body", b""))
+            if not message.get("more_body", False):
+                finished.set()
+
+    await main.app(scope, receive, send)
+    return status, b"".join(chunks)
+
+
+async def drain_jobs():
+    """Wait for background job generations started by submit_job"""
+    while main.job_tasks:
+        await asyncio.gather(*list(main.job_tasks))
+
+
+def configure(upstream, upstream_ratio):
+    """Point main at an upstream and set how often cache hits still reach it"""
+    main.upstream = upstream
+    main.variations.upstream_ratio = upstream_ratio
+    main.variations.max_reuses = 1 << 30
+
+
+def make_cases():
+    """Cases keyed by name: (setup, request, expected status)
+
+    setup runs once before sampling; request is a coroutine function making
+    one sampled request (or, for the job case, one submit/collect round trip).
+    """
+    deflated = encode_body(BODY, "deflate", main.COMPRESSION_WBITS)
+
+    def post(body, headers=(), path="/consulta"):
+        return lambda: call("POST", path, body, headers)
+
+    async def idempotent_first():
+        configure(BenchUpstream(), 1.0)
+        await call("POST", "/consulta", BODY, [("Idempotency-Key", "bench-replay")])
+
+    async def job_roundtrip():
+        _, ticket = await call("POST", "/consulta/jobs", BODY)
+        await drain_jobs()
+        status, _ = await call("GET", f"/consulta/jobs/{json.loads(ticket)['ticket']}")
+        return status, None
+
+    async def use(upstream, ratio):
+        configure(upstream, ratio)
+
+    return {
+        # Every request goes to the upstream, as a cache miss would
+        "consulta_upstream": (lambda: use(BenchUpstream(), 1.0), post(BODY), 200),
+        # Cache hit served as a variation, no upstream call
+        "consulta_variation": (lambda: use(BenchUpstream(), 0.0), post(BODY), 200),
+        "consulta_deflate": (lambda: use(BenchUpstream(), 1.0),
+                             post(deflated, [("Content-Encoding", "deflate"), ("Accept-Encoding", "deflate")]), 200),
+        "consulta_idempotent_replay": (idempotent_first,
+                                       post(BODY, [("Idempotency-Key", "bench-replay")]), 200),
+        "jobs_roundtrip": (lambda: use(BenchUpstream(), 1.0), job_roundtrip, 200),
+        # Error paths
+        "error_invalid_json": (lambda: use(BenchUpstream(), 1.0), post(INVALID_JSON_BODY), 422),
+        "error_missing_field": (lambda: use(BenchUpstream(), 1.0), post(MISSING_FIELD_BODY), 422),
+        "error_upstream_500": (lambda: use(BenchUpstream(failing=True), 1.0), post(UNCACHED_BODY), 200),
+        # Failed refresh of a cached state, answered with a variation of the cached response
+        "error_upstream_500_cached": (lambda: use(BenchUpstream(failing=True), 1.0), post(BODY), 200),
+        "error_idempotency_conflict": (idempotent_first,
+                                       post(CONFLICT_BODY, [("Idempotency-Key", "bench-replay")]), 422)
+    }
+
+
+def make_stage_cases():
+    """Steps of a /consulta request keyed by name, each a zero-argument callable"""
+    data = main.parse_context(BODY)
+    history = "drying (+900/h); watered 2d3h ago; normal for 1d"
+    trace = NullTrace()
+    upstream = BenchUpstream()
+    body = upstream.bodies[0]
+    result = None
+
+    def prompt():
+        text = main.TEMPLATE.format(history=history, **data.dict())
+        return {"contents": [{"parts": [{"text": text}]}], "generationConfig": main.GENERATION_CONFIG}
+
+    def upstream_call():
+        return main.ask_upstream(data, history, trace, time.perf_counter())
+
+    def decode():
+        parsed = DecodingResponse(200, body).json()
+        return parsed["candidates"][0]["content"]["parts"][0]["text"]
+
+    def encode():
+        return main.JSONResponse(result, status_code=200).body
+
+    def setup():
+        nonlocal result
+        configure(upstream, 1.0)
+        result = upstream_call()
+
+    return setup, {
+        "stage_validate": lambda: main.parse_context(BODY),
+        "stage_prompt": prompt,
+        "stage_upstream_call": upstream_call,
+        "stage_decode": decode,
+        "stage_encode": encode
+    }
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * fraction))]
+
+
+def summarize(cpu_ns, wall_ns, peak, retained):
+    return {
+        "cpu_us": round(statistics.median(cpu_ns) / 1000, 2),
+        "cpu_us_p90": round(percentile(cpu_ns, 0.9) / 1000, 2),
+        "wall_us": round(statistics.median(wall_ns) / 1000, 2),
+        "peak_alloc_bytes": peak,
+        "retained_bytes_per_request": round(retained, 2)
+    }
+
+
+async def measure_async(request, expected, samples, alloc_samples, warmup):
+    """CPU, wall time and allocations of an ASGI case"""
+    for _ in range(warmup):
+        status, _ = await request()
+        if status != expected:
+            raise RuntimeError(f"answered {status}, expected {expected}")
+
+    gc.collect()
+    cpu_ns, wall_ns = [], []
+    for _ in range(samples):
+        wall = time.perf_counter_ns()
+        cpu = time.process_time_ns()
+        await request()
+        cpu_ns.append(time.process_time_ns() - cpu)
+        wall_ns.append(time.perf_counter_ns() - wall)
+
+    tracemalloc.start()
+    try:
+        peak = 0
+        start_current, _ = tracemalloc.get_traced_memory()
+        for _ in range(alloc_samples):
+            before, _ = tracemalloc.get_traced_memory()
+            tracemalloc.reset_peak()
+            await request()
+            _, request_peak = tracemalloc.get_traced_memory()
+            peak = max(peak, request_peak - before)
+        end_current, _ = tracemalloc.get_traced_memory()
+    finally:
+        tracemalloc.stop()
+    return summarize(cpu_ns, wall_ns, peak, (end_current - start_current) / alloc_samples)
+
+
+def measure_stage(func, samples, alloc_samples, warmup):
+    """CPU, wall time and allocations of a stage case"""
+    for _ in range(warmup):
+        func()
+
+    gc.collect()
+    cpu_ns, wall_ns = [], []
+    for _ in range(samples):
+        wall = time.perf_counter_ns()
+        cpu = time.process_time_ns()
+        func()
+        cpu_ns.append(time.process_time_ns() - cpu)
+        wall_ns.append(time.perf_counter_ns() - wall)
+
+    tracemalloc.start()
+    try:
+        func()
+        peak = 0
+        start_current, _ = tracemalloc.get_traced_memory()
+        for _ in range(alloc_samples):
+            before, _ = tracemalloc.get_traced_memory()
+            tracemalloc.reset_peak()
+            func()
+            _, call_peak = tracemalloc.get_traced_memory()
+            peak = max(peak, call_peak - before)
+        end_current, _ = tracemalloc.get_traced_memory()
+    finally:
+        tracemalloc.stop()
+    return summarize(cpu_ns, wall_ns, peak, (end_current - start_current) / alloc_samples)
+
+
+async def run(samples, alloc_samples, warmup, only=None):
+    """Measure every case
+
+    Returns:
+        dict: Results keyed by case name
+    """
+    results = {}
+    for name, (setup, request, expected) in make_cases().items():
+        if only and name not in only:
+            continue
+        await setup()
+        try:
+            results[name] = await measure_async(request, expected, samples, alloc_samples, warmup)
+        except RuntimeError as e:
+            raise RuntimeError(f"{name}: {e}")
+        await drain_jobs()
+
+    setup, stages = make_stage_cases()
+    setup()
+    for name, func in stages.items():
+        if only and name not in only:
+            continue
+        results[name] = measure_stage(func, samples, alloc_samples, warmup)
+    return results
+
+
+def commit_id():
+    """Current commit, marked "-dirty" with uncommitted changes; None outside a git checkout"""
+    try:
+        head = subprocess.run(["git", "rev-parse", "--short", "HEAD"], capture_output=True, text=True,
+                              check=True).stdout.strip()
+        dirty = subprocess.run(["git", "status", "--porcelain", "--untracked-files=no"], capture_output=True,
+                               text=True, check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+    return head + ("-dirty" if dirty else "")
+
+
+def compare(report, baseline, cpu_tolerance, alloc_tolerance):
+    """Compare a run with a baseline run
+
+    Returns:
+        tuple: (regressions, notes) as lists of descriptions
+    """
+    regressions = []
+    notes = []
+    for key in ("python", "implementation", "machine"):
+        if report[key] != baseline.get(key):
+            notes.append(f"{key} differs from the baseline ({baseline.get(key)}); CPU figures may not compare")
+    for name, result in report["results"].items():
+        base = baseline["results"].get(name)
+        if base is None:
+            notes.append(f"{name}: not in the baseline")
+            continue
+        cpu_limit = base["cpu_us"] * (1 + cpu_tolerance)
+        if result["cpu_us"] > cpu_limit:
+            regressions.append(f"{name}: {result['cpu_us']}us CPU, baseline {base['cpu_us']}us "
+                               f"(+{(result['cpu_us'] / base['cpu_us'] - 1) * 100:.0f}%)")
+        for metric in ("peak_alloc_bytes", "retained_bytes_per_request"):
+            limit = base[metric] * (1 + alloc_tolerance) + ALLOC_SLACK_BYTES
+            if result[metric] > limit:
+                regressions.append(f"{name}: {metric} {result[metric]}, baseline {base[metric]}")
+    return regressions, notes
+
+
+def main_cli():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--samples", type=int, default=500, help="Timed requests per case")
+    parser.add_argument("--alloc-samples", type=int, default=100, help="Requests traced for allocations")
+    parser.add_argument("--warmup", type=int, default=50, help="Untimed requests before sampling")
+    parser.add_argument("--only", nargs="+", help="Run only these cases")
+    parser.add_argument("--json", help="Write the report to this file")
+    parser.add_argument("--compare", help="Baseline report from another commit; exit 1 on regression")
+    parser.add_argument("--cpu-tolerance", type=float, default=DEFAULT_CPU_TOLERANCE,
+                        help="Allowed CPU time growth as a fraction of the baseline")
+    parser.add_argument("--alloc-tolerance", type=float, default=DEFAULT_ALLOC_TOLERANCE,
+                        help="Allowed allocation growth as a fraction of the baseline")
+    args = parser.parse_args()
+
+    results = asyncio.run(run(args.samples, args.alloc_samples, args.warmup, args.only))
+    report = {
+        "commit": commit_id(),
+        "python": platform.python_version(),
+        "implementation": platform.python_implementation(),
+        "machine": platform.machine(),
+        "samples": args.samples,
+        "results": results
+    }
+
+    print(f"{'case':28} {'CPU us':>9} {'p90 us':>9} {'wall us':>9} {'peak B':>8} {'kept B':>8}")
+    for name, result in results.items():
+        print(f"{name:28} {result['cpu_us']:>9} {result['cpu_us_p90']:>9} {result['wall_us']:>9} "
+              f"{result['peak_alloc_bytes']:>8} {result['retained_bytes_per_request']:>8}")
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=2)
+
+    if args.compare:
+        with open(args.compare) as f:
+            baseline = json.load(f)
+        regressions, notes = compare(report, baseline, args.cpu_tolerance, args.alloc_tolerance)
+        for note in notes:
+            print("NOTE:", note)
+        for regression in regressions:
+            print(f"REGRESSION {regression}")
+        if regressions:
+            sys.exit(1)
+        print(f"No regressions against {baseline.get('commit') or args.compare}")
+
+
+if __name__ == "__main__":
+    main_cli()
@@ -0,0 +1,337 @@
+"""Soak test of the PlantMonitor loop under an emulated heap budget
+
+    python -m tools.soak_test --iterations 300000 --heap-kb 64
+    python -m tools.soak_test --iterations 20000 --json soak.json
+
+Runs read_and_display_status back to back on the host fakes with sleeps
+disabled and an AI request every cycle. Sensors, the network and the AI
+responses follow a seeded script that mixes normal cycles with DHT errors,
+shed and failed requests, timeouts, expired jobs and malformed or very long
+melodies.
+
+tracemalloc stands in for the CircuitPython heap: memory allocated above the
+level right after startup must stay under --heap-kb, including each cycle's
+transient peak. CPython objects are several times larger than their
+CircuitPython equivalents, so treat the budget as relative, and watch growth
+per iteration and the largest allocations rather than absolute bytes. The
+cycle's garbage is collected every iteration, as MicroPython's collector
+would under pressure. Exits 1 if the budget is exceeded or memory keeps
+growing; growth is only meaningful over tens of thousands of iterations, so
+it is not checked with fewer than MIN_GROWTH_SAMPLES steady-state samples.
+"""
+import argparse
+import array
+import collections
+import contextlib
+import gc
+import json
+import os
+import random
+import sys
+import time
+import tracemalloc
+import zlib
+from tools import host
+from tools.host.clock import no_sleep
+from tools.host.fakes import FakeResponse
+from tools.device_bench import NullWriter
+
+# Steady-state samples needed before growth is gated; shorter runs are dominated by noise
+MIN_GROWTH_SAMPLES = 64
+
+# Sources whose allocations count as the device's, for the largest-block report
+DEVICE_PATHS = ("code.py", "config.py", "ai", "alerts", "display", "sensors", "utils", "lib")
+
+NOTES = ("C4", "D4", "E4", "F4", "G4", "A4", "B4", "C5", "R")
+
+
+class SoakScript:
+    """Seeded sensor, network and AI behaviour for the soak run"""
+
+    def __init__(self, seed, variants=256):
+        self.rng = random.Random(seed)
+        self.soil = 22000
+        self.outcomes = collections.Counter()
+        # Bodies are built up front so the fake server's own allocations
+        # (a deflate compressor alone is ~170 KB) stay out of the measurement
+        self.generations = [self.generation() for _ in range(variants)]
+
+    def update(self, env, iteration):
+        """Advance the plant and sensor faults by one cycle"""
+        rng = self.rng
+        # Slow drying with an occasional watering
+        self.soil += rng.randint(-20, 60)
+        if self.soil > 30000 or rng.random() < 0.001:
+            self.soil = 16000
+        env.soil = self.soil
+        env.temperature = 22.0 + 6.0 * ((iteration % 1440) / 1440.0) + rng.uniform(-0.5, 0.5)
+        env.humidity = 55.0 + rng.uniform(-20, 25)
+        env.dht_error = RuntimeError("Checksum did not validate") if rng.random() < 0.05 else None
+
+    def melody(self, notes):
+        return ",".join(f"{self.rng.choice(NOTES)},{self.rng.choice(('0.25', '0.5', '1.0'))}" for _ in range(notes))
+
+    def ai_text(self, kind):
+        """A generation as the server might return it, well-formed or not"""
+        if kind == "normal":
+            return f"MESSAGE: Feeling fine\nMELODY: {self.melody(self.rng.randint(4, 12))}"
+        if kind == "unlabelled":
+            return f"Here you go\n{self.melody(6)}"
+        if kind == "long":
+            return f"MESSAGE: Epic tune\nMELODY: {self.melody(120)}"
+        if kind == "garbage":
+            return "".join(self.rng.choice("ABC,.0123 \n:") for _ in range(self.rng.randint(1, 400)))
+        if kind == "empty":
+            return ""
+        return f"MESSAGE: {'very ' * 60}happy\nMELODY: C4,0.5"
+
+    def generation(self):
+        """A finished job response: (kind, body, deflated body)"""
+        kind = self.rng.choices(
+            ("normal", "unlabelled", "long", "garbage", "empty", "long_message"),
+            weights=(70, 8, 8, 6, 4, 4)
+        )[0]
+        content = json.dumps({"respuesta": self.ai_text(kind), "status": "done"}).encode()
+        compressor = zlib.compressobj(6, zlib.DEFLATED, 10)
+        return kind, content, compressor.compress(content) + compressor.flush()
+
+    def respond(self, method, url, body, headers):
+        """env.network hook: scripted server behaviour"""
+        rng = self.rng
+        if "/profiles/" in url:
+            return FakeResponse(304, b"")
+        
+        roll = rng.random()
+        if roll < 0.02:
+            self.outcomes["timeout"] += 1
+            raise OSError(116, "ETIMEDOUT")
+        if roll < 0.05:
+            self.outcomes["http_500"] += 1
+            return FakeResponse(500, b"Internal Server Error")
+        if roll < 0.10:
+            self.outcomes["http_503"] += 1
+            return FakeResponse(503, b'{"error": "busy"}', {"Retry-After": "0"})
+        
+        if method == "POST":
+            self.outcomes["job_submitted"] += 1
+            ticket = "%032x" % rng.getrandbits(128)
+            return FakeResponse(202, json.dumps({"ticket": ticket, "retry_after": 0}).encode())
+        if roll < 0.15:
+            self.outcomes["job_pending"] += 1
+            return FakeResponse(202, b'{"status": "pending"}', {"Retry-After": "0"})
+        if roll < 0.17:
+            self.outcomes["job_expired"] += 1
+            return FakeResponse(404, b'{"error": "unknown ticket"}')
+        
+        kind, content, deflated = rng.choice(self.generations)
+        self.outcomes["ai_" + kind] += 1
+        if headers.get("Accept-Encoding") == "deflate" and rng.random() < 0.5:
+            return FakeResponse(200, deflated, {"Content-Encoding": "deflate"})
+        return FakeResponse(200, content)
+
+
+def is_device_frame(filename):
+    relative = os.path.relpath(filename, host.REPO_ROOT)
+    return not relative.startswith("..") and relative.split(os.sep)[0] in DEVICE_PATHS
+
+
+def largest_blocks(largest):
+    """Record the largest live block allocated at each device source line
+
+    Args:
+        largest (dict): "file:line" -> bytes, updated in place
+    """
+    snapshot = tracemalloc.take_snapshot()
+    for trace in snapshot.traces:
+        frame = trace.traceback[0]
+        if is_device_frame(frame.filename):
+            where = f"{os.path.relpath(frame.filename, host.REPO_ROOT)}:{frame.lineno}"
+            if trace.size > largest.get(where, 0):
+                largest[where] = trace.size
+
+
+class AllocationProfiler:
+    """Largest single-step allocations of a cycle, by call site
+
+    Runs a call under sys.setprofile and reads tracemalloc's current size at
+    every call and return. Growth between two consecutive events is one
+    step: usually a single allocation such as a response body, a decompress
+    buffer or a split list. Transient allocations freed before the end of
+    the cycle are caught too, unlike in a snapshot.
+    """
+
+    def __init__(self):
+        self.largest = {}
+        self.last = 0
+        # Bytes held by the profiler's own records, subtracted from retained memory
+        self.overhead = 0
+
+    def run(self, func):
+        self.last = tracemalloc.get_traced_memory()[0]
+        sys.setprofile(self.profile)
+        try:
+            func()
+        finally:
+            sys.setprofile(None)
+
+    def profile(self, frame, event, arg):
+        current = tracemalloc.get_traced_memory()[0]
+        grown = current - self.last
+        if grown > 256 and is_device_frame(frame.f_code.co_filename):
+            name = getattr(arg, "__qualname__", frame.f_code.co_name) if event.startswith("c_") else frame.f_code.co_name
+            where = f"{os.path.relpath(frame.f_code.co_filename, host.REPO_ROOT)}:{frame.f_lineno} {name}"
+            if grown > self.largest.get(where, 0):
+                before = tracemalloc.get_traced_memory()[0]
+                self.largest[where] = grown
+                self.overhead += tracemalloc.get_traced_memory()[0] - before
+        self.last = tracemalloc.get_traced_memory()[0]
+
+    def report(self, limit=5):
+        return [
+            {"bytes": size, "where": where}
+            for where, size in sorted(self.largest.items(), key=lambda item: -item[1])[:limit]
+        ]
+
+
+def steady_samples(samples):
+    """Samples after the first fifth, which is ignored as warm-up"""
+    return samples[len(samples) // 5:]
+
+
+def growth_per_iteration(samples):
+    """Least-squares slope of retained bytes over iterations in the steady state"""
+    steady = steady_samples(samples)
+    if len(steady) < 2:
+        return 0.0
+    mean_x = sum(x for x, _ in steady) / len(steady)
+    mean_y = sum(y for _, y in steady) / len(steady)
+    spread = sum((x - mean_x) ** 2 for x, _ in steady)
+    if spread == 0:
+        return 0.0
+    return sum((x - mean_x) * (y - mean_y) for x, y in steady) / spread
+
+
+def soak(iterations, heap_bytes, sample_every, profile_every, seed, warmup=200):
+    """Run the loop under the heap budget
+
+    Returns:
+        dict: Report
+    """
+    code = host.install()
+    import ai.melody_generator
+    ai.melody_generator.AI_REQUEST_INTERVAL = 0
+    
+    script = SoakScript(seed)
+    env = host.activate(host.DeviceEnv())
+    env.network = script.respond
+    # Keep the fakes' own request log out of the measurement
+    env.requests = collections.deque(maxlen=1)
+    
+    # Preallocated so recording a sample allocates nothing that would look like growth
+    retained = array.array("q", bytes(8 * (iterations // sample_every + 1)))
+    sampled = 0
+    largest = {}
+    profiler = AllocationProfiler()
+    peak = 0
+    exhausted_at = None
+    started = time.perf_counter()
+    
+    with contextlib.redirect_stdout(NullWriter()), no_sleep():
+        monitor = code.PlantMonitor()
+        monitor.ambient_sensor._min_read_interval = 0
+        monitor.startup_sequence()
+        
+        # Warm-up cycles, profiled so line tables and other lazily built
+        # interpreter state exist before the baseline is taken
+        for iteration in range(warmup):
+            script.update(env, iteration)
+            profiler.run(monitor.read_and_display_status)
+        
+        # Startup objects are never garbage; frozen, they cost nothing per collection
+        gc.collect()
+        gc.freeze()
+        tracemalloc.start(1)
+        baseline, _ = tracemalloc.get_traced_memory()
+        try:
+            for iteration in range(iterations):
+                script.update(env, iteration)
+                # MicroPython frees nothing until a collection; collecting every cycle
+                # leaves only live objects plus this cycle's garbage in the peak
+                gc.collect()
+                tracemalloc.reset_peak()
+                if iteration % profile_every == 0:
+                    profiler.run(monitor.read_and_display_status)
+                else:
+                    monitor.read_and_display_status()
+                current, cycle_peak = tracemalloc.get_traced_memory()
+                peak = max(peak, cycle_peak - baseline)
+                if cycle_peak - baseline > heap_bytes:
+                    exhausted_at = iteration
+                    largest_blocks(largest)
+                    break
+                if iteration % sample_every == 0:
+                    retained[sampled] = current - baseline - profiler.overhead
+                    sampled += 1
+                if iteration % (sample_every * 20) == 0:
+                    largest_blocks(largest)
+        finally:
+            gc.collect()
+            final, _ = tracemalloc.get_traced_memory()
+            tracemalloc.stop()
+            gc.unfreeze()
+    
+    samples = [(index * sample_every, retained[index]) for index in range(sampled)]
+    growth = growth_per_iteration(samples)
+    return {
+        "iterations": iterations if exhausted_at is None else exhausted_at + 1,
+        "seconds": round(time.perf_counter() - started, 1),
+        "heap_budget_bytes": heap_bytes,
+        "heap_exhausted_at": exhausted_at,
+        "peak_bytes": peak,
+        "final_bytes": final - baseline,
+        "growth_bytes_per_iteration": round(growth, 4),
+        "growth_samples": len(steady_samples(samples)),
+        "growth_bytes_per_day": round(growth * 86400 / code.MAIN_LOOP_DELAY),
+        "largest_allocations": profiler.report(),
+        "largest_live_blocks": [
+            {"bytes": size, "where": where}
+            for where, size in sorted(largest.items(), key=lambda item: -item[1])[:5]
+        ],
+        "scripted_outcomes": dict(script.outcomes),
+        "errors_at_end": monitor.error_count,
+        "samples": samples
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--iterations", type=int, default=200000)
+    parser.add_argument("--heap-kb", type=float, default=64.0, help="Heap available after startup")
+    parser.add_argument("--max-growth", type=float, default=0.1, help="Allowed steady growth, bytes per iteration")
+    parser.add_argument("--sample-every", type=int, default=500, help="Iterations between retained-memory samples")
+    parser.add_argument("--profile-every", type=int, default=50, help="Iterations between allocation-profiled cycles")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--json", help="Write the report, with the memory samples, to this file")
+    args = parser.parse_args()
+
+    report = soak(args.iterations, int(args.heap_kb * 1024), args.sample_every, args.profile_every, args.seed)
+    
+    summary = {name: value for name, value in report.items() if name != "samples"}
+    print(json.dumps(summary, indent=2))
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=2)
+    
+    if report["heap_exhausted_at"] is not None:
+        print(f"FAIL heap budget exceeded at iteration {report['heap_exhausted_at']}")
+        sys.exit(1)
+    if report["growth_samples"] < MIN_GROWTH_SAMPLES:
+        print(f"NOTE growth not checked: {report['growth_samples']} steady-state samples, "
+              f"need {MIN_GROWTH_SAMPLES} (run more iterations or lower --sample-every)")
+    elif report["growth_bytes_per_iteration"] > args.max_growth:
+        print(f"FAIL memory grows {report['growth_bytes_per_iteration']} bytes per iteration")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
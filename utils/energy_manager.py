@@ -0,0 +1,148 @@
+import time
+from config import (
+    BATTERY_CAPACITY_MAH,
+    BATTERY_TARGET_DAYS,
+    ENERGY_CURRENT_MA,
+    ENERGY_LEVELS,
+    ENERGY_WINDOW,
+    ENERGY_RECOVER_RATIO
+)
+from utils.logger import log
+
+class EnergyManager:
+    """Estimates charge drawn per component and picks a power level that fits the battery budget
+
+    Components report when they switch on and off; charge is on-time times
+    the component's modelled current from ENERGY_CURRENT_MA. Time the CPU is
+    not marked awake is charged at the 'idle' current. Every ENERGY_WINDOW
+    seconds the window's average current is compared with the budget
+    (battery capacity spread over the target lifetime) and the level moves
+    one step toward saving or back toward full service.
+    """
+
+    def __init__(self, capacity_mah=BATTERY_CAPACITY_MAH, target_days=BATTERY_TARGET_DAYS,
+                 currents=None, levels=None):
+        """Initialize the energy manager
+
+        Args:
+            capacity_mah (float): Usable battery capacity
+            target_days (float): Lifetime to budget for, or None to only track usage
+            currents (dict): Modelled current draw in mA per component
+            levels (list): Policies from full service to deepest saving
+        """
+        self.capacity_mah = capacity_mah
+        self.currents = currents or ENERGY_CURRENT_MA
+        self.levels = levels or ENERGY_LEVELS
+        self.level = 0
+        self.set_target_days(target_days)
+
+        self.charge_mah = {name: 0.0 for name in self.currents}
+        self.on_since = {}
+        self.started = time.monotonic()
+        self.window_start = self.started
+        self.window_mah = 0.0
+
+    def set_target_days(self, target_days):
+        """Budget for a new battery lifetime
+
+        Args:
+            target_days (float): Lifetime in days, or None to only track usage
+        """
+        self.target_days = target_days
+        # Average current the battery can sustain for the target lifetime
+        self.budget_ma = self.capacity_mah / (target_days * 24) if target_days else None
+
+    def start(self, component):
+        """Mark a component as drawing current (no-op if already on)"""
+        if component not in self.on_since:
+            self.on_since[component] = time.monotonic()
+
+    def stop(self, component):
+        """Mark a component as off and charge its on-time (no-op if already off)"""
+        since = self.on_since.pop(component, None)
+        if since is not None:
+            self.charge(component, time.monotonic() - since)
+
+    def is_on(self, component):
+        return component in self.on_since
+
+    def charge(self, component, seconds):
+        """Add seconds of on-time at the component's modelled current"""
+        mah = self.currents.get(component, 0) * seconds / 3600
+        self.charge_mah[component] = self.charge_mah.get(component, 0.0) + mah
+        self.window_mah += mah
+
+    def settle(self):
+        """Charge running components and idle time up to now
+
+        Running components are charged and restarted, so totals are current
+        without ending their on-periods.
+        """
+        now = time.monotonic()
+        for component in list(self.on_since):
+            self.charge(component, now - self.on_since[component])
+            self.on_since[component] = now
+
+        # Idle draw covers whatever part of the elapsed time the CPU was not awake
+        elapsed = now - self.started
+        awake_seconds = self.charge_mah.get('cpu', 0.0) * 3600 / self.currents['cpu'] if self.currents.get('cpu') else 0
+        idle_mah = max(0.0, elapsed - awake_seconds) * self.currents.get('idle', 0) / 3600
+        self.window_mah += idle_mah - self.charge_mah.get('idle', 0.0)
+        self.charge_mah['idle'] = idle_mah
+        return now
+
+    def update(self):
+        """Settle charge and move one level if the last window broke or beat the budget
+
+        Returns:
+            bool: True if the level changed
+        """
+        now = self.settle()
+        if self.budget_ma is None or now - self.window_start < ENERGY_WINDOW:
+            return False
+
+        average_ma = self.window_mah * 3600 / (now - self.window_start)
+        self.window_start = now
+        self.window_mah = 0.0
+
+        if average_ma > self.budget_ma and self.level < len(self.levels) - 1:
+            self.level += 1
+        elif average_ma < self.budget_ma * ENERGY_RECOVER_RATIO and self.level > 0:
+            self.level -= 1
+        else:
+            return False
+        log.info("Energy: %.2fmA against %.2fmA budget, level %d", average_ma, self.budget_ma, self.level)
+        return True
+
+    def policy(self):
+        """Settings for the current level
+
+        Returns:
+            dict: 'ai_interval', 'loop_delay', 'backlight_timeout' (None = always on),
+            'alerts' ('full', 'changes' or 'urgent') and 'radio_off'
+        """
+        return self.levels[self.level]
+
+    def used_mah(self):
+        return sum(self.charge_mah.values())
+
+    def get_energy_report(self):
+        """Charge per component and the lifetime it projects to
+
+        Returns:
+            dict: Energy usage summary
+        """
+        now = self.settle()
+        used = self.used_mah()
+        hours = (now - self.started) / 3600
+        average_ma = used / hours if hours > 0 else 0.0
+        remaining = max(0.0, self.capacity_mah - used)
+        return {
+            'charge_mah': dict(self.charge_mah),
+            'used_mah': used,
+            'average_ma': average_ma,
+            'budget_ma': self.budget_ma,
+            'projected_days': (self.capacity_mah / average_ma / 24) if average_ma > 0 else None,
+            'remaining_mah': remaining,
+            'level': self.level
+        }
@@ -0,0 +1,142 @@
+import time
+from config import LOG_LEVEL, LOG_BUFFER_SIZE, LOG_PERSIST_PATH, LOG_PERSIST_RECORDS
+
+DEBUG = 10
+INFO = 20
+WARNING = 30
+ERROR = 40
+
+LEVEL_NAMES = {DEBUG: "DEBUG", INFO: "INFO", WARNING: "WARN", ERROR: "ERROR"}
+LEVELS = {"DEBUG": DEBUG, "INFO": INFO, "WARNING": WARNING, "ERROR": ERROR}
+
+
+def _drop(message, *args):
+    pass
+
+
+def _detach(args):
+    # A held exception keeps its traceback and every frame on it alive, so
+    # warnings and errors, the levels exceptions are logged at, keep only the text
+    for arg in args:
+        if isinstance(arg, Exception):
+            return tuple(str(arg) if isinstance(arg, Exception) else arg for arg in args)
+    return args
+
+
+class Logger:
+    """Leveled logger that keeps records in a ring buffer until the loop is idle
+
+    A record holds the message template and its arguments; the string is
+    only built when the record is written out, so logging in the sensing loop
+    costs a few list stores instead of formatting and a blocking USB serial
+    write. Methods for levels below the threshold are bound to a no-op when
+    the logger is created, so filtered calls cost one empty function call.
+    When the buffer is full the oldest records are overwritten and counted.
+    """
+
+    def __init__(self, level=LOG_LEVEL, size=LOG_BUFFER_SIZE, persist_path=LOG_PERSIST_PATH,
+                 persist_records=LOG_PERSIST_RECORDS):
+        """Initialize the logger
+
+        Args:
+            level (str): Lowest level kept: "DEBUG", "INFO", "WARNING" or "ERROR"
+            size (int): Records held between flushes
+            persist_path (str): Flash file for the last records, or None to disable
+            persist_records (int): Records written by persist()
+        """
+        self.level = LEVELS.get(level, INFO)
+        self.size = size
+        self.persist_path = persist_path
+        self.persist_records = persist_records
+
+        # Preallocated slots; head is the next slot written, count the unflushed
+        # records and stored all records still held (flushed ones are kept for persist)
+        self.times = [0.0] * size
+        self.levels = bytearray(size)
+        self.messages = [None] * size
+        self.args = [None] * size
+        self.head = 0
+        self.count = 0
+        self.stored = 0
+        self.dropped = 0
+
+        self.debug = self._debug if DEBUG >= self.level else _drop
+        self.info = self._info if INFO >= self.level else _drop
+        self.warning = self._warning if WARNING >= self.level else _drop
+        self.error = self._error
+
+    def _record(self, level, message, args):
+        head = self.head
+        self.times[head] = time.monotonic()
+        self.levels[head] = level
+        self.messages[head] = message
+        self.args[head] = args
+        self.head = (head + 1) % self.size
+        if self.stored < self.size:
+            self.stored += 1
+        if self.count < self.size:
+            self.count += 1
+        else:
+            self.dropped += 1
+
+    def _debug(self, message, *args):
+        self._record(DEBUG, message, args)
+
+    def _info(self, message, *args):
+        self._record(INFO, message, args)
+
+    def _warning(self, message, *args):
+        self._record(WARNING, message, _detach(args))
+
+    def _error(self, message, *args):
+        self._record(ERROR, message, _detach(args))
+
+    def format(self, index):
+        """Text of the record in a buffer slot"""
+        message = self.messages[index]
+        args = self.args[index]
+        if args:
+            try:
+                message = message % args
+            except (TypeError, ValueError):
+                message = " ".join([str(message)] + [str(arg) for arg in args])
+        return "%.1f %s %s" % (self.times[index], LEVEL_NAMES.get(self.levels[index], "?"), message)
+
+    def flush(self, limit=None):
+        """Write buffered records to the console, oldest first
+
+        Called while the loop is idle, so the serial writes do not delay a reading.
+
+        Args:
+            limit (int): Most records to write this call, or None for all
+        """
+        if self.dropped:
+            print("%d log records dropped" % self.dropped)
+            self.dropped = 0
+        written = 0
+        while self.count > 0 and (limit is None or written < limit):
+            index = (self.head - self.count) % self.size
+            print(self.format(index))
+            self.count -= 1
+            written += 1
+
+    def persist(self):
+        """Save the most recent records to flash for post-mortem reading
+
+        Flushed records are included. CIRCUITPY is read-only to code unless
+        boot.py remounts it, so failures are ignored.
+        """
+        if not self.persist_path:
+            return
+        count = min(self.stored, self.persist_records)
+        try:
+            with open(self.persist_path, "w") as f:
+                for offset in range(count, 0, -1):
+                    f.write(self.format((self.head - offset) % self.size))
+                    f.write("\n")
+        except OSError:
+            pass
+
+
+# Shared by all device modules
+log = Logger()
@@ -0,0 +1,130 @@
+import random
+import struct
+from config import MELODY_PACK_PATH
+from utils.logger import log
+
+# Pack layout (little-endian), written by tools/melody_pack.py:
+#   header        magic, version, status count, melody count
+#   status table  per status: name length, name, first melody, melody count
+#   melody index  per melody: data offset, note count
+#   note data     per note: note index, duration in milliseconds
+MAGIC = b"BHMP"
+VERSION = 1
+HEADER = "<4sBBH"
+STATUS_ENTRY = "<HH"
+INDEX_ENTRY = "<IH"
+NOTE = "<BH"
+HEADER_SIZE = struct.calcsize(HEADER)
+STATUS_ENTRY_SIZE = struct.calcsize(STATUS_ENTRY)
+INDEX_ENTRY_SIZE = struct.calcsize(INDEX_ENTRY)
+NOTE_SIZE = struct.calcsize(NOTE)
+
+# Note indices count semitones up from C3, the lowest note in MUSICAL_NOTES
+NOTE_NAMES = ("C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B")
+LOWEST_OCTAVE = 3
+REST_INDEX = 255
+
+
+def note_name(index):
+    """Note name in MUSICAL_NOTES for a pack note index"""
+    if index == REST_INDEX:
+        return "R"
+    return NOTE_NAMES[index % 12] + str(index // 12 + LOWEST_OCTAVE)
+
+
+class MelodyPack:
+    """Factory-provisioned melodies per plant status, read from flash
+
+    Only the status table is kept in memory; each lookup reads one index
+    entry and one melody's notes from the file, so the pack can hold far
+    more melodies than would fit in RAM. Played when no AI melody is
+    available, so a board has varied melodies from its first boot.
+    """
+
+    def __init__(self, path=MELODY_PACK_PATH):
+        """Load the pack's status table
+
+        Args:
+            path (str): Pack file on flash, or None to disable
+        """
+        self.path = path
+        self.statuses = {}
+        self.index_offset = 0
+        self.data_offset = 0
+        if path:
+            self.load()
+
+    def load(self):
+        """Read the header and status table; a missing or invalid pack leaves it empty
+
+        Returns:
+            bool: True if the pack was loaded
+        """
+        self.statuses = {}
+        try:
+            with open(self.path, "rb") as f:
+                header = f.read(HEADER_SIZE)
+                if len(header) != HEADER_SIZE:
+                    return self.invalid("is truncated")
+                magic, version, status_count, melody_count = struct.unpack(HEADER, header)
+                if magic != MAGIC or version != VERSION:
+                    return self.invalid("has an unknown format")
+                statuses = {}
+                for _ in range(status_count):
+                    length = f.read(1)
+                    name = f.read(length[0]) if length else b""
+                    entry = f.read(STATUS_ENTRY_SIZE)
+                    if not name or len(entry) != STATUS_ENTRY_SIZE:
+                        return self.invalid("is truncated")
+                    statuses[name.decode()] = struct.unpack(STATUS_ENTRY, entry)
+                self.index_offset = f.tell()
+        except OSError:
+            return False  # No pack provisioned
+        except UnicodeError:
+            return self.invalid("has an unreadable status name")
+        self.data_offset = self.index_offset + melody_count * INDEX_ENTRY_SIZE
+        self.statuses = statuses
+        log.info("Melody pack: %d melodies for %d statuses", melody_count, len(statuses))
+        return True
+
+    def invalid(self, reason):
+        log.warning("Melody pack %s %s", self.path, reason)
+        return False
+
+    def melody(self, status, choice=None):
+        """A melody for a plant status
+
+        Args:
+            status (str): Overall status from PlantAnalyzer
+            choice (int): Melody number within the status, or None for a random one
+
+        Returns:
+            str: Melody in the "note,duration,..." format play_ai_melody takes,
+            or None if the pack has none for the status
+        """
+        entry = self.statuses.get(status)
+        if entry is None or not entry[1]:
+            return None
+        first, count = entry
+        index = first + (random.randint(0, count - 1) if choice is None else choice % count)
+        try:
+            with open(self.path, "rb") as f:
+                f.seek(self.index_offset + index * INDEX_ENTRY_SIZE)
+                entry = f.read(INDEX_ENTRY_SIZE)
+                if len(entry) != INDEX_ENTRY_SIZE:
+                    return None
+                offset, notes = struct.unpack(INDEX_ENTRY, entry)
+                f.seek(self.data_offset + offset)
+                data = f.read(notes * NOTE_SIZE)
+        except OSError as e:
+            log.warning("Melody pack read failed: %s", e)
+            return None
+        if len(data) != notes * NOTE_SIZE:
+            return None
+
+        parts = []
+        for position in range(0, len(data), NOTE_SIZE):
+            note, milliseconds = struct.unpack_from(NOTE, data, position)
+            parts.append(note_name(note))
+            parts.append(str(milliseconds / 1000))
+        return ",".join(parts)
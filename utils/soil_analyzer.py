@@ -173,6 +173,46 @@ class PlantAnalyzer:
         if temp_high is not None:
             self.ambient_thresholds['temperature']['high'] = temp_high
     
+    def apply_profile(self, profile):
+        """Replace all thresholds with a species profile from the server
+        
+        The profile is checked first, so a malformed one leaves the current
+        thresholds untouched.
+        
+        Args:
+            profile (dict): Profile with 'soil' and 'ambient' thresholds
+            
+        Returns:
+            bool: True if the profile was applied
+        """
+        try:
+            soil = {'dry': profile['soil']['dry'], 'normal': profile['soil']['normal']}
+            ambient = {
+                'humidity': {
+                    'low': profile['ambient']['humidity']['low'],
+                    'high': profile['ambient']['humidity']['high']
+                },
+                'temperature': {
+                    'low': profile['ambient']['temperature']['low'],
+                    'high': profile['ambient']['temperature']['high']
+                }
+            }
+            values = (soil['dry'], soil['normal'],
+                      ambient['humidity']['low'], ambient['humidity']['high'],
+                      ambient['temperature']['low'], ambient['temperature']['high'])
+            if not all(isinstance(value, (int, float)) and not isinstance(value, bool) for value in values):
+                return False
+            if (soil['normal'] >= soil['dry'] or
+                ambient['humidity']['low'] >= ambient['humidity']['high'] or
+                ambient['temperature']['low'] >= ambient['temperature']['high']):
+                return False
+        except (KeyError, TypeError):
+            return False
+        
+        self.soil_thresholds = soil
+        self.ambient_thresholds = ambient
+        return True
+    
     def get_current_thresholds(self):
         """Get current threshold values
         